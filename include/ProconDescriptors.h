@@ -0,0 +1,76 @@
+/*
+ * USB descriptors for the Pro Controller personality.
+ * Enabled with SWITCH_PERSONALITY_PROCON, see procon.h for the protocol.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define PROCON_ENDPOINT_SIZE 64
+
+static const uint8_t procon_string_language[] = {0x09, 0x04};
+static const uint8_t procon_string_manufacturer[] = "Nintendo Co., Ltd.";
+static const uint8_t procon_string_product[] = "Pro Controller";
+static const uint8_t procon_string_serial[] = "000000000001";
+
+static const uint8_t *procon_string_descriptors[] =
+	{
+		procon_string_language,
+		procon_string_manufacturer,
+		procon_string_product,
+		procon_string_serial};
+
+static const uint8_t procon_device_descriptor[] =
+	{
+		0x12,		// bLength
+		0x01,		// bDescriptorType (Device)
+		0x00, 0x02, // bcdUSB 2.00
+		0x00,		// bDeviceClass (Use class information in the Interface Descriptors)
+		0x00,		// bDeviceSubClass
+		0x00,		// bDeviceProtocol
+		0x40,		// bMaxPacketSize0 64
+		0x7E, 0x05, // idVendor 0x057E
+		0x09, 0x20, // idProduct 0x2009
+		0x00, 0x02, // bcdDevice 2.00
+		0x01,		// iManufacturer (String Index)
+		0x02,		// iProduct (String Index)
+		0x03,		// iSerialNumber (String Index)
+		0x01,		// bNumConfigurations 1
+};
+
+// The console identifies the Pro Controller by VID/PID and never parses the
+// report layout, so every report is declared as 63 vendor bytes behind its ID.
+static const uint8_t procon_report_descriptor[] =
+	{
+		0x05, 0x01,		  // Usage Page (Generic Desktop Ctrls)
+		0x15, 0x00,		  // Logical Minimum (0)
+		0x09, 0x04,		  // Usage (Joystick)
+		0xA1, 0x01,		  // Collection (Application)
+		0x06, 0x00, 0xFF, //   Usage Page (Vendor Defined 0xFF00)
+		0x75, 0x08,		  //   Report Size (8)
+		0x26, 0xFF, 0x00, //   Logical Maximum (255)
+		0x95, 0x3F,		  //   Report Count (63)
+		0x85, 0x30,		  //   Report ID (0x30) standard full mode input
+		0x09, 0x30,		  //   Usage (0x30)
+		0x81, 0x02,		  //   Input (Data,Var,Abs)
+		0x85, 0x21,		  //   Report ID (0x21) subcommand reply
+		0x09, 0x21,		  //   Usage (0x21)
+		0x81, 0x02,		  //   Input (Data,Var,Abs)
+		0x85, 0x81,		  //   Report ID (0x81) USB command reply
+		0x09, 0x81,		  //   Usage (0x81)
+		0x81, 0x02,		  //   Input (Data,Var,Abs)
+		0x85, 0x01,		  //   Report ID (0x01) rumble and subcommand
+		0x09, 0x01,		  //   Usage (0x01)
+		0x91, 0x02,		  //   Output (Data,Var,Abs)
+		0x85, 0x10,		  //   Report ID (0x10) rumble only
+		0x09, 0x10,		  //   Usage (0x10)
+		0x91, 0x02,		  //   Output (Data,Var,Abs)
+		0x85, 0x80,		  //   Report ID (0x80) USB command
+		0x09, 0x80,		  //   Usage (0x80)
+		0x91, 0x02,		  //   Output (Data,Var,Abs)
+		0x85, 0x82,		  //   Report ID (0x82)
+		0x09, 0x82,		  //   Usage (0x82)
+		0x91, 0x02,		  //   Output (Data,Var,Abs)
+		0xC0,			  // End Collection
+};
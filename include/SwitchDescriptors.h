@@ -41,6 +41,13 @@
 #define SWITCH_JOYSTICK_MID 0x80
 #define SWITCH_JOYSTICK_MAX 0xFF
 
+// Internal stick resolution is 12 bits (Pro Controller native).
+// The HORI report keeps the top 8 bits.
+#define SWITCH_STICK_MIN 0x000
+#define SWITCH_STICK_MID 0x800
+#define SWITCH_STICK_MAX 0xFFF
+#define SWITCH_STICK_TO_JOYSTICK(v) ((uint8_t) ((v) >> 4))
+
 typedef struct __attribute((packed, aligned(1)))
 {
 	uint16_t buttons;
@@ -52,19 +59,22 @@ typedef struct __attribute((packed, aligned(1)))
 	uint8_t vendor;
 } SwitchReport;
 
+// Adapter side controller state, sticks in SWITCH_STICK_* units.
+// Packed into SwitchReport or a Pro Controller report before sending.
 typedef struct
 {
 	uint16_t buttons;
 	uint8_t hat;
-	uint8_t lx;
-	uint8_t ly;
-	uint8_t rx;
-	uint8_t ry;
+	uint16_t lx;
+	uint16_t ly;
+	uint16_t rx;
+	uint16_t ry;
 } SwitchOutReport;
 
 typedef struct {
     uint8_t idx;
     SwitchOutReport report;
+    uint32_t time_us; // time_us_32() when core1 published it
 } SwitchIdxOutReport;
 
 static const uint8_t switch_string_language[] = {0x09, 0x04};
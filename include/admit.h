@@ -0,0 +1,65 @@
+#ifndef _ADMIT_H_
+#define _ADMIT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <uni.h>
+
+#include "sdkconfig.h"
+
+// Connection admission, core1 only.
+// Inquiry and page scan share the CYW43 radio with the live keyboard and
+// mouse links, every scan slot is a slot their packets wait behind. So
+// scanning is only on when a new device can actually be taken:
+// - with no device connected it stays on, there is nothing to protect
+// - with every device slot taken it is off
+// - otherwise it runs in ADMIT_SCAN_WINDOW_MS windows every
+//   ADMIT_SCAN_PERIOD_MS, or for ADMIT_PAIRING_MS after the pairing chord
+// A bonded device that drops reconnects in the next window.
+// Discovered devices are filtered on their Class of Device: keyboards,
+// mice and combos, and gamepads as long as they are mapped (ADMIT_GAMEPADS).
+// Mouse report jitter is kept apart for scanning on and off
+// (STAT_MOUSE_JITTER_SCAN_US, STAT_MOUSE_JITTER_IDLE_US, see link.c).
+
+// Devices taken before scanning stops
+#ifndef ADMIT_MAX_DEVICES
+#define ADMIT_MAX_DEVICES CONFIG_BLUEPAD32_MAX_DEVICES
+#endif
+
+#ifndef ADMIT_SCAN_PERIOD_MS
+#define ADMIT_SCAN_PERIOD_MS 15000
+#endif
+#ifndef ADMIT_SCAN_WINDOW_MS
+#define ADMIT_SCAN_WINDOW_MS 3000
+#endif
+
+// Pairing chord: left ctrl + left alt + P opens a window right away
+#ifndef ADMIT_PAIRING_MS
+#define ADMIT_PAIRING_MS 30000
+#endif
+#define ADMIT_PAIR_MODIFIERS 0x05 // left ctrl, left alt
+#define ADMIT_PAIR_KEY 0x13       // KEY_P
+
+// Accept gamepads next to keyboards and mice. On by default so the gamepad
+// passthrough keeps working, ADAPTER_KM_ONLY builds have no gamepad mapping.
+#ifndef ADMIT_GAMEPADS
+#define ADMIT_GAMEPADS (!ADAPTER_KM_ONLY)
+#endif
+
+// From on_init_complete, instead of enabling new connections for good
+void admit_start(void);
+
+// Devices connected and ready, after every change
+void admit_set_devices(int count);
+
+// on_device_discovered: UNI_ERROR_IGNORE_DEVICE for anything that is not
+// a keyboard or mouse
+uni_error_t admit_device_discovered(uint16_t cod);
+
+// Every keyboard report, watches for the pairing chord
+void admit_keyboard_event(uint8_t modifiers, const uint8_t *keys, int count);
+
+bool admit_scanning(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _BOOT_LAYOUT_H_
+#define _BOOT_LAYOUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// HID report descriptor check behind the boot fast path (boot_parser.h).
+// Pure logic, no SDK calls.
+
+typedef enum {
+	BOOT_LAYOUT_NONE = 0,
+	BOOT_LAYOUT_KEYBOARD,
+	BOOT_LAYOUT_MOUSE,
+} BootLayoutKind;
+
+typedef struct {
+	BootLayoutKind kind;
+	uint8_t report_id; // 0 when the descriptor has no report IDs
+	bool has_wheel;
+} BootLayout;
+
+// Input report fields at their boot protocol byte offsets
+typedef struct {
+	uint8_t modifiers;
+	uint8_t keys[6];
+} BootKeyboard;
+
+typedef struct {
+	uint8_t buttons;
+	int8_t x, y, wheel;
+} BootMouse;
+
+// Walks a HID report descriptor, true if its input report is boot compatible
+bool boot_layout_from_descriptor(const uint8_t *desc, int len, BootLayout *out);
+
+// Decode one input report of a device with that layout, false for a short
+// report or one with another report ID
+bool boot_layout_keyboard(const BootLayout *layout, const uint8_t *report, uint16_t len,
+                          BootKeyboard *out);
+bool boot_layout_mouse(const BootLayout *layout, const uint8_t *report, uint16_t len,
+                       BootMouse *out);
+
+#endif
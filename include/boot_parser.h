@@ -0,0 +1,27 @@
+#ifndef _BOOT_PARSER_H_
+#define _BOOT_PARSER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <uni.h>
+
+#include "boot_layout.h"
+
+// Fast path for keyboards and mice whose reports use the boot layout
+// (8 byte keyboard, 3-5 byte mouse). Their report descriptor is checked
+// once when the device is ready; matching devices get a direct decoder in
+// place of Bluepad32's generic usage walk.
+
+#ifndef BOOT_FAST_PATH
+#define BOOT_FAST_PATH 1
+#endif
+
+// core1, on device ready: installs the fast path when possible, otherwise
+// instruments the generic parser so both paths can be compared.
+void boot_parser_install(uni_hid_device_t *d);
+
+// core1, from on_controller_data: accounts the generic parse of this report
+void boot_parser_report_done(uni_hid_device_t *d);
+
+#endif
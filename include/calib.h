@@ -0,0 +1,70 @@
+#ifndef _CALIB_H_
+#define _CALIB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SwitchDescriptors.h"
+
+// Camera turn calibration.
+// Games put their own curve between right stick deflection and turn rate
+// (dead zone, slow start, acceleration), so a fixed counts-to-deflection
+// scale turns a different angle in every game and at every mouse speed.
+// Calibration measures that curve and the profile keeps its inverse:
+// mouse motion becomes a turn rate first (stick_mdeg_per_count) and then
+// the deflection the game answers with that rate, so the same mouse
+// distance is always the same angle.
+//
+// Procedure, CALIB_TOGGLE_KEY starts (and aborts) it. For each probe,
+// from the smallest deflection to full:
+//   line the view up with a landmark and hold CALIB_HOLD_KEY, the adapter
+//   holds the probe deflection to the right. Release when the landmark has
+//   come round once, the hold time gives the rate of a full turn.
+//   CALIB_SKIP_KEY records "does not turn" (inside the game's dead zone),
+//   CALIB_BACK_KEY repeats the previous probe.
+// After the last probe the rates are fitted and the curve goes into the
+// active profile.
+// Pure logic, no SDK calls: the fit can be run on a host.
+
+#ifndef CALIB_TOGGLE_KEY
+#define CALIB_TOGGLE_KEY 0x42 // KEY_F9
+#endif
+#define CALIB_HOLD_KEY 0x2C // KEY_SPACE
+#define CALIB_SKIP_KEY 0x28 // KEY_ENTER
+#define CALIB_BACK_KEY 0x2A // KEY_BACKSPACE
+
+// Probe deflections are 1/CALIB_PROBES .. full
+#define CALIB_PROBES 8
+#define CALIB_LUT_SIZE 17
+#define CALIB_FULL_DEFLECTION (SWITCH_STICK_MAX - SWITCH_STICK_MID)
+
+// Inverse of a game's stick response
+typedef struct {
+	// turn rate at full deflection, millidegrees per second, 0 if uncalibrated
+	uint32_t max_rate_mdps;
+	// deflection from center for i / (CALIB_LUT_SIZE - 1) of that rate,
+	// lut[0] is the edge of the game's dead zone
+	uint16_t lut[CALIB_LUT_SIZE];
+} TurnCurve;
+
+// Fits the curve to n measurements, deflection ascending. rate_mdps 0
+// means it did not turn. Noise is smoothed into a non-decreasing
+// response first. Returns false if nothing turned.
+bool calib_fit(const uint16_t *deflection, const uint32_t *rate_mdps, int n, TurnCurve *out);
+
+// Signed deflection from center for a signed turn rate, saturates at full
+int32_t calib_deflection(const TurnCurve *curve, int32_t rate_mdps);
+
+// Deflection for delta mouse counts over interval_us, each count turning
+// mdeg_per_count: the rate, saturated to int32, through calib_deflection
+int32_t calib_mouse_deflection(const TurnCurve *curve, uint16_t mdeg_per_count,
+                               int32_t delta, uint32_t interval_us);
+
+// core1: feed every keyboard report. Returns true while calibrating, out
+// then holds the probe deflection and the report must not reach the pad.
+bool calib_keyboard_event(SwitchOutReport *out, const uint8_t *keys, int count, uint32_t now_ms);
+
+// Probe being measured, 1-based, 0 when not calibrating
+int calib_probe(void);
+
+#endif
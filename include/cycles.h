@@ -0,0 +1,32 @@
+#ifndef _CYCLES_H_
+#define _CYCLES_H_
+
+#include <stdint.h>
+
+#include <hardware/structs/systick.h>
+
+// Cycle counting on the per-core SysTick (24-bit, counts down at the core
+// clock). Good for sections shorter than ~100 ms at 125 MHz.
+// cycles_init() must run once on every core that measures.
+
+static inline void
+cycles_init(void)
+{
+	systick_hw->rvr = 0x00FFFFFF;
+	systick_hw->cvr = 0;
+	systick_hw->csr = 0x5; // enable, processor clock, no interrupt
+}
+
+static inline uint32_t
+cycles_now(void)
+{
+	return systick_hw->cvr;
+}
+
+static inline uint32_t
+cycles_since(uint32_t start)
+{
+	return (start - systick_hw->cvr) & 0x00FFFFFF;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _DEDUP_H_
+#define _DEDUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb.h"
+#include "SwitchDescriptors.h"
+
+// Repeat suppression of the pad reports, at both ends of the handoff.
+// core1 drops a publish that maps to what the pad last published (a
+// mouse move on a saturated stick). All pads share one mailbox, so a
+// publish that overwrites another pad's unread report forgets what that
+// pad published: its next report, even a repeat, goes out again.
+// core0 drops a HORI report equal to the last one queued on its pad,
+// except every USB_KEEPALIVE_MS, and only a report the stack accepted
+// counts as queued.
+// Pure logic, no SDK calls.
+
+typedef struct {
+	SwitchOutReport published[USB_HID_GAMEPADS];
+	bool published_once[USB_HID_GAMEPADS];
+} PublishDedup;
+
+// True if the report has to be published, and records it. Reports of
+// pads outside the table always are.
+bool dedup_publish(PublishDedup *d, const SwitchIdxOutReport *src);
+
+// The shared report of pad unread_idx, never read, is replaced by one of idx
+void dedup_overwritten(PublishDedup *d, uint8_t unread_idx, uint8_t idx);
+
+typedef enum {
+	DEDUP_SEND,
+	DEDUP_KEEPALIVE, // unchanged, re-sent to refresh the console
+	DEDUP_SUPPRESS,
+} DedupSend;
+
+typedef struct {
+	SwitchReport last_sent[USB_HID_GAMEPADS];
+	uint32_t last_sent_ms[USB_HID_GAMEPADS];
+	bool sent_once[USB_HID_GAMEPADS];
+} SendDedup;
+
+DedupSend dedup_send(const SendDedup *d, uint8_t idx, const SwitchReport *out, uint32_t now_ms);
+
+// Result of queueing out, ok false leaves the last sent report as it was
+void dedup_queued(SendDedup *d, uint8_t idx, const SwitchReport *out, uint32_t now_ms, bool ok);
+
+#endif
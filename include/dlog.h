@@ -0,0 +1,61 @@
+#ifndef _DLOG_H_
+#define _DLOG_H_
+
+#include <stdint.h>
+
+// Deferred binary logging.
+// DLOG("fmt", a, b) stores the format string address, a timestamp and up
+// to four 32-bit arguments in a per-core ring; nothing is formatted on the
+// target. The rings are drained over USB as feature reports
+// (DLOG_REPORT_ID + core, usb.h has the interface), and tools/dlog.py
+// formats the records with the strings from the firmware ELF.
+// Arguments are integers or pointers; %s only resolves for strings in
+// flash. Each core only logs to its own ring, never from interrupts.
+
+#ifndef DLOG_ENABLED
+#define DLOG_ENABLED 1
+#endif
+
+// Records per core, a power of two
+#ifndef DLOG_RING_SIZE
+#define DLOG_RING_SIZE 128
+#endif
+
+#define DLOG_REPORT_ID 0x38 // 0x38 core0, 0x39 core1
+#define DLOG_MAX_ARGS 4
+
+typedef struct {
+	uint32_t fmt;
+	uint32_t time_us;
+	uint32_t args[DLOG_MAX_ARGS];
+} DlogRecord;
+
+void dlog_write(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+// Moves the oldest records of a core's ring into a feature report:
+// [count, dropped since last read, count * DlogRecord]. Returns its length.
+uint16_t dlog_fill_report(uint8_t core, uint8_t *buf, uint16_t len);
+
+#if DLOG_ENABLED
+
+#define DLOG_ARG(x) ((uint32_t) (uintptr_t) (x))
+#define DLOG_NARGS(...) DLOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, n, ...) n
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b) a##b
+
+#define DLOG_0(f) dlog_write(f, 0, 0, 0, 0)
+#define DLOG_1(f, a) dlog_write(f, DLOG_ARG(a), 0, 0, 0)
+#define DLOG_2(f, a, b) dlog_write(f, DLOG_ARG(a), DLOG_ARG(b), 0, 0)
+#define DLOG_3(f, a, b, c) dlog_write(f, DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), 0)
+#define DLOG_4(f, a, b, c, d) dlog_write(f, DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d))
+
+#define DLOG(fmt, ...) DLOG_CAT(DLOG_, DLOG_NARGS(__VA_ARGS__))(fmt, ##__VA_ARGS__)
+
+#else
+
+#define DLOG(fmt, ...) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef _GAMEPAD_H_
+#define _GAMEPAD_H_
+
+#include <stdint.h>
+
+#include "SwitchDescriptors.h"
+
+// Bluetooth gamepad state to a pad contribution (passthrough of classic
+// gamepads, mixed mode with keyboard and mouse in slot.c).
+// Axes go through a table built once at init that already holds the
+// 12-bit scaling, clamping and deadzone, so an axis costs one bounds
+// check and one load. The D-pad maps to the hat through a 16-entry table.
+// Pure logic, no SDK calls: GamepadState mirrors the fields of
+// Bluepad32's uni_gamepad_t and the bits below are Bluepad32's, checked
+// against its headers where the state is copied over.
+
+#define GAMEPAD_AXIS_MIN (-512) // Bluepad32 axes, -512..511
+#define GAMEPAD_AXIS_COUNT 1024
+#define GAMEPAD_AXIS_DEADZONE 0xa0 // 12-bit units around center
+
+// DPAD_*
+#define GAMEPAD_DPAD_UP 0x01
+#define GAMEPAD_DPAD_DOWN 0x02
+#define GAMEPAD_DPAD_RIGHT 0x04
+#define GAMEPAD_DPAD_LEFT 0x08
+
+// BUTTON_*
+#define GAMEPAD_BUTTON_A 0x0001
+#define GAMEPAD_BUTTON_B 0x0002
+#define GAMEPAD_BUTTON_X 0x0004
+#define GAMEPAD_BUTTON_Y 0x0008
+#define GAMEPAD_BUTTON_SHOULDER_L 0x0010
+#define GAMEPAD_BUTTON_SHOULDER_R 0x0020
+#define GAMEPAD_BUTTON_TRIGGER_L 0x0040
+#define GAMEPAD_BUTTON_TRIGGER_R 0x0080
+#define GAMEPAD_BUTTON_THUMB_L 0x0100
+#define GAMEPAD_BUTTON_THUMB_R 0x0200
+
+// MISC_BUTTON_*
+#define GAMEPAD_MISC_SYSTEM 0x01
+#define GAMEPAD_MISC_SELECT 0x02
+#define GAMEPAD_MISC_START 0x04
+#define GAMEPAD_MISC_CAPTURE 0x08
+
+typedef struct {
+	uint8_t dpad;
+	uint8_t misc_buttons;
+	uint16_t buttons;
+	int32_t axis_x, axis_y, axis_rx, axis_ry;
+	int32_t brake, throttle; // analog triggers, any pressure is ZL / ZR
+} GamepadState;
+
+// Builds the axis table, before the first event
+void gamepad_init(void);
+
+// Bluepad32 axis to a 12-bit stick position
+uint16_t gamepad_axis(int32_t axis);
+
+// ORs the buttons into out and sets its hat and sticks
+void gamepad_fill(SwitchOutReport *out, const GamepadState *gp);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _GYRO_H_
+#define _GYRO_H_
+
+#include <stdint.h>
+
+#include "procon.h"
+
+// Mouse to gyroscope synthesis for AIM_MODE_GYRO.
+// Mouse counts become angle (profile scale), the angle is spread over the
+// report's IMU samples and quantized to gyro LSBs with the rounding error
+// carried forward, so integrating the samples gives back the mouse angle.
+
+// Pro Controller gyro at +-2000 dps: 70 mdps per LSB.
+// The console integrates every sample over 5 ms (200 Hz IMU),
+// so one LSB in one sample turns 70 mdps * 5 ms = 350 udeg.
+#define GYRO_UDEG_PER_LSB_SAMPLE 350
+
+// Accelerometer reading for 1 G (+-8 G range)
+#define GYRO_ACCEL_1G 4096
+
+void gyro_reset(void);
+
+// Turns mouse counts accumulated since the previous report into
+// PROCON_IMU_SAMPLES samples.
+void gyro_synthesize(int32_t dx, int32_t dy, ProconImuSample out[PROCON_IMU_SAMPLES]);
+
+#endif
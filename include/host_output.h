@@ -0,0 +1,26 @@
+#ifndef _HOST_OUTPUT_H_
+#define _HOST_OUTPUT_H_
+
+#include <stdint.h>
+
+// Console OUT reports (player LEDs, rumble) forwarded to the BT devices.
+// core0 parses every report and keeps only the latest state in a seqlock
+// mailbox; core1 picks it up on a timer and writes to the devices only when
+// it changed, so the radio sees at most one update per interval.
+
+#ifndef HOST_OUTPUT_FORWARD_INTERVAL_MS
+#define HOST_OUTPUT_FORWARD_INTERVAL_MS 50
+#endif
+
+// Devices get rumble with a bounded duration, re-sent this often while on
+#ifndef HOST_OUTPUT_RUMBLE_REFRESH_MS
+#define HOST_OUTPUT_RUMBLE_REFRESH_MS 500
+#endif
+
+// core0, from tud_hid_set_report_cb. buf starts at the report ID.
+void host_output_on_report(const uint8_t *buf, uint16_t len);
+
+// core1, arms the forwarding timer on the BTstack run loop
+void host_output_start(void);
+
+#endif
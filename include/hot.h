@@ -0,0 +1,32 @@
+#ifndef _HOT_H_
+#define _HOT_H_
+
+// Memory placement of the report path (ADAPTER_HOT_IN_RAM, a CMake option).
+//   HOT_FN     code run from SRAM instead of XIP flash, so a cache miss
+//              (BTstack or the other core evicting lines) never stalls
+//              mapping, the report exchange or the USB loop
+//   HOT_DATA   read-only tables of that code, copied to SRAM as well
+//   CORE0_DATA data only core0 touches, in SCRATCH_Y next to its stack
+//   CORE1_DATA data only core1 touches, in SCRATCH_X next to its stack
+// The scratch banks are private to one core in practice, so its accesses
+// never wait behind the other core on the striped main banks. Buffers
+// shared by both cores (report.c) stay in main SRAM.
+// Each scratch bank is 4 KB including the 2 KB stack; keep big tables out.
+// Without the option the macros are empty, so the pure modules also build
+// on the host (tests/).
+
+#if ADAPTER_HOT_IN_RAM
+#include <pico/platform.h>
+
+#define HOT_FN(name) __not_in_flash_func(name)
+#define HOT_DATA(name) __not_in_flash(#name) name
+#define CORE0_DATA(name) __scratch_y(#name) name
+#define CORE1_DATA(name) __scratch_x(#name) name
+#else
+#define HOT_FN(name) name
+#define HOT_DATA(name) name
+#define CORE0_DATA(name) name
+#define CORE1_DATA(name) name
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _LINK_H_
+#define _LINK_H_
+
+#include <uni.h>
+
+// Bluetooth link tuning and health monitor, core1 only.
+// BLE devices are asked for the shortest connection interval they accept,
+// classic devices are kept out of sniff mode. Negotiated parameters, RSSI
+// and report arrival jitter are published per link in the stats pages
+// (STAT_LINK, see stats.h) so a laggy device can be spotted from the host.
+
+// BLE interval request, in 1.25 ms units. The max is widened step by step
+// up to the ceiling while the device rejects the update.
+#ifndef LINK_BLE_INTERVAL_MIN
+#define LINK_BLE_INTERVAL_MIN 6 // 7.5 ms, the spec minimum
+#endif
+
+#ifndef LINK_BLE_INTERVAL_CEILING
+#define LINK_BLE_INTERVAL_CEILING 24 // 30 ms
+#endif
+
+#ifndef LINK_BLE_SUPERVISION_TIMEOUT
+#define LINK_BLE_SUPERVISION_TIMEOUT 200 // 2 s, in 10 ms units
+#endif
+
+// Classic links: refuse sniff and leave it if the device forces it anyway
+#ifndef LINK_AVOID_SNIFF
+#define LINK_AVOID_SNIFF 1
+#endif
+
+// Pending HCI commands and RSSI reads are issued from this timer
+#ifndef LINK_POLL_INTERVAL_MS
+#define LINK_POLL_INTERVAL_MS 250
+#endif
+
+// Gaps longer than this are idle time (a still mouse sends nothing),
+// not jitter
+#ifndef LINK_IDLE_GAP_US
+#define LINK_IDLE_GAP_US 100000
+#endif
+
+// Registers the HCI event handler and starts the poll timer
+void link_start(void);
+
+void link_on_device_connected(uni_hid_device_t *d);
+
+// From on_controller_data, one call per input report
+void link_on_report(uni_hid_device_t *d);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef _LOADGEN_H_
+#define _LOADGEN_H_
+
+// Synthetic load generator, built as the SwitchKMAdapter_loadgen target
+// (ADAPTER_LOADGEN=1). Core1 runs it instead of Bluepad32: it registers
+// keyboards and mice with the platform as if they had connected and feeds
+// them events through the real on_controller_data, so mapping, the slot
+// merge, the report exchange and the USB path all run as in production.
+// The rate ramps up step by step until publishes start being overwritten
+// before core0 reads them; the last clean rate is the adapter's ceiling.
+// Results are in the stats pages (tools/stats.py): loadgen_*, the USB age
+// histogram and publish_overwritten.
+
+// Devices fed, spread over the pads (ADAPTER_SLOT_PER_DEVICE)
+#ifndef LOADGEN_DEVICES
+#define LOADGEN_DEVICES 4
+#endif
+
+// First rate and increment, events per second over all devices
+#ifndef LOADGEN_START_RATE
+#define LOADGEN_START_RATE 250
+#endif
+
+#ifndef LOADGEN_RATE_STEP
+#define LOADGEN_RATE_STEP 250
+#endif
+
+// Time spent at each rate before judging it
+#ifndef LOADGEN_STEP_MS
+#define LOADGEN_STEP_MS 2000
+#endif
+
+// A step is clean while fewer than 1 in this many publishes is overwritten
+#ifndef LOADGEN_OVERWRITE_TOLERANCE
+#define LOADGEN_OVERWRITE_TOLERANCE 100
+#endif
+
+// core1 entry point, replaces bluepad_core_task()
+void loadgen_core_task(void);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _MEMSTATS_H_
+#define _MEMSTATS_H_
+
+// RAM usage instrumentation, published in the stats pages.
+// Both core stacks are painted with a pattern at boot; the untouched words
+// give the high-water mark. Heap peak comes from newlib's mallinfo, the
+// Bluetooth pool peaks from the number of live HCI connections and
+// Bluepad32 devices. tools/memmap.py reports the static side (.data and
+// .bss per module) from the linker map. The XIP cache hit counters are
+// sampled on the same timer, to see what running from flash costs.
+
+#ifndef MEMSTATS_SAMPLE_INTERVAL_MS
+#define MEMSTATS_SAMPLE_INTERVAL_MS 1000
+#endif
+
+// core0, first thing in main(), before core1 is launched
+void memstats_paint_stacks(void);
+
+// core1, registers the HCI event handler and starts sampling
+void memstats_start(void);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _MOVE_H_
+#define _MOVE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SwitchDescriptors.h"
+
+// Analog movement from the WASD keys.
+// core1 keeps the intent of each keyboard (directions held, walking or
+// not) and merges it per pad the way slot.h merges buttons: a direction
+// is held while any keyboard of the pad holds it. It only publishes the
+// merged intent; core0 turns it into a left stick position on the USB frame
+// clock, so ramps advance exactly one step per 1 ms frame whatever the
+// keyboard's report rate. The stick eases up to the target deflection
+// and back to center along one precomputed curve (fixed point, built at
+// init), so every frame costs a table lookup. Diagonals are normalized
+// onto the circle instead of the square corner.
+
+// Ramp lengths, in frames (ms). 0 jumps straight to the target.
+#ifndef MOVE_ACCEL_MS
+#define MOVE_ACCEL_MS 120
+#endif
+#ifndef MOVE_DECEL_MS
+#define MOVE_DECEL_MS 60
+#endif
+
+// Held, this modifier caps the deflection (walking, tiptoeing).
+// Left shift and control are L3 and R3 already.
+#ifndef MOVE_WALK_MODIFIER
+#define MOVE_WALK_MODIFIER 0x04 // left alt
+#endif
+#ifndef MOVE_WALK_PERCENT
+#define MOVE_WALK_PERCENT 50
+#endif
+
+// core0, before the USB loop
+void move_init(void);
+
+// core1: keyboard state of a device (slot.h numbering) playing in pad.
+// keys NULL (or count 0) releases all, a pad out of range as well.
+void move_keyboard_event(uint8_t device, uint8_t pad, uint8_t modifiers,
+                         const uint8_t *keys, int count);
+
+// core1: drops whatever the device holds, when it leaves its pad
+void move_release(uint8_t device);
+
+// core0: adds the pad's movement to the left stick of out, with frame the
+// USB frame number (11 bits)
+void move_apply(uint8_t pad, SwitchOutReport *out, uint16_t frame);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _OSK_H_
+#define _OSK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SwitchDescriptors.h"
+
+// On-screen keyboard typing.
+// While active, typed characters are turned into the shortest D-pad path
+// on the console keyboard plus an A press. Steps are planned on core1 and
+// queued to core0, which plays one press/release per step paced on the
+// USB frame clock.
+
+#ifndef OSK_TOGGLE_KEY
+#define OSK_TOGGLE_KEY 0x43 // KEY_F10
+#endif
+
+// Hold and gap per step, in 1 ms USB frames
+#ifndef OSK_PRESS_FRAMES
+#define OSK_PRESS_FRAMES 34
+#endif
+#ifndef OSK_RELEASE_FRAMES
+#define OSK_RELEASE_FRAMES 34
+#endif
+
+// Use diagonal hat directions to move on both axes at once
+#ifndef OSK_DIAGONALS
+#define OSK_DIAGONALS 0
+#endif
+
+// core1: feed every keyboard report. Returns true while typing mode is on,
+// the report must then not be mapped to the pad.
+bool osk_keyboard_event(uint8_t modifiers, const uint8_t *keys, int count);
+
+// core0: call once per frame with the USB frame number (11 bits, 1 ms).
+// Returns true and fills out while a step is being played.
+bool osk_next_frame(SwitchOutReport *out, uint16_t frame);
+
+#endif
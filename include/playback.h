@@ -0,0 +1,102 @@
+#ifndef _PLAYBACK_H_
+#define _PLAYBACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SwitchDescriptors.h"
+
+// Input playback from flash, for reproducing issues on the console.
+// A recording is loaded next to the firmware at PLAYBACK_FLASH_OFFSET
+// (tools/playback.py builds it and prints the picotool command) and read
+// straight from XIP flash through one cursor, so a long session takes no
+// more RAM than a short one. It must end before the BTstack flash bank
+// (PICO_FLASH_BANK_STORAGE_OFFSET, the last 8 KB), records past it are
+// not played.
+// Every record carries the USB frames since the previous one. core0
+// releases them on the frame clock (SOF), so the timing is reproduced to
+// the frame:
+//   PLAYBACK_PAD       a finished pad report, sent as is. While playing,
+//                      a pad that has received one belongs to the
+//                      recording and live input no longer reaches it.
+//   PLAYBACK_KEYBOARD  raw keyboard or mouse state, queued to core1 and
+//   PLAYBACK_MOUSE     mapped like a Bluetooth report, as a virtual
+//                      device joining the record's pad
+// The chord left ctrl + left alt + F12 starts playback, pressed again
+// it stops. The end of the recording stops it as well.
+
+#ifndef PLAYBACK_FLASH_OFFSET
+#define PLAYBACK_FLASH_OFFSET (1024 * 1024)
+#endif
+
+#define PLAYBACK_MAGIC 0x31424C50 // "PLB1"
+
+#define PLAYBACK_CHORD_MODIFIERS 0x05 // left ctrl, left alt
+#define PLAYBACK_CHORD_KEY 0x45       // KEY_F12
+
+// Virtual devices for raw input records
+#define PLAYBACK_DEVICES 4
+
+// core0 -> core1 raw input records in flight
+#ifndef PLAYBACK_QUEUE_SIZE
+#define PLAYBACK_QUEUE_SIZE 16
+#endif
+
+enum {
+	PLAYBACK_PAD,
+	PLAYBACK_KEYBOARD,
+	PLAYBACK_MOUSE,
+	PLAYBACK_END, // not stored, tells core1 the virtual devices are gone
+};
+
+// STAT_PLAYBACK_STATE
+enum {
+	PLAYBACK_STATE_IDLE,
+	PLAYBACK_STATE_PLAYING,
+	PLAYBACK_STATE_NO_RECORDING,
+};
+
+typedef struct __attribute((packed, aligned(1))) {
+	uint32_t magic;
+	uint32_t count; // records following the header
+} PlaybackHeader;
+
+// 16 bytes, little-endian, keep in sync with tools/playback.py
+typedef struct __attribute((packed, aligned(1))) {
+	uint16_t frames; // USB frames after the previous record
+	uint8_t kind;
+	uint8_t pad;
+	uint8_t device; // raw input, 0 .. PLAYBACK_DEVICES - 1
+	union {
+		struct __attribute((packed, aligned(1))) {
+			uint16_t buttons;
+			uint8_t hat;
+			uint16_t lx, ly, rx, ry; // SWITCH_STICK_* units
+		} report;
+		struct __attribute((packed, aligned(1))) {
+			uint8_t modifiers;
+			uint8_t keys[6];
+		} keyboard;
+		struct __attribute((packed, aligned(1))) {
+			int16_t dx, dy;
+			int8_t wheel;
+			uint8_t buttons;
+		} mouse;
+	};
+} PlaybackRecord;
+
+// core1: raw input records arrive here, from the async context
+void playback_start(void (*on_input)(const PlaybackRecord *rec));
+
+// core1: every Bluetooth keyboard report, watches for the chord
+void playback_keyboard_event(uint8_t modifiers, const uint8_t *keys, int count);
+
+// core0: once the frame's report is due, with live the report read from
+// core1 and frame the USB frame number (11 bits). Returns true with out
+// filled when a played report goes out instead.
+bool playback_next_frame(const SwitchIdxOutReport *live, SwitchIdxOutReport *out, uint16_t frame);
+
+// core0: the report playback_next_frame() filled was queued
+void playback_sent(const SwitchIdxOutReport *out);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _PROCON_H_
+#define _PROCON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SwitchDescriptors.h"
+
+// Pro Controller USB protocol.
+// The console drives a 0x80 handshake, then configures the pad through
+// 0x01 subcommands; we answer from an emulated SPI flash image and stream
+// 0x30 full mode reports once the console asks for them.
+// Pure protocol code, no SDK calls, so it runs on the host as well.
+
+#define PROCON_REPORT_SIZE 64
+
+// 0x30 reports carry three IMU samples
+#define PROCON_IMU_SAMPLES 3
+
+typedef struct {
+	int16_t accel[3];
+	int16_t gyro[3];
+} ProconImuSample;
+
+void procon_init(const uint8_t mac[6]);
+
+// Feed an OUT report (buffer starts at the report ID).
+void procon_handle_output(const uint8_t *buf, uint16_t len);
+
+// Build the next IN report into buf (PROCON_REPORT_SIZE bytes, report ID
+// first). Pending replies go out before input reports.
+// imu may be NULL, the samples then report a pad at rest.
+// Returns the report length, 0 if there is nothing to send yet.
+uint16_t procon_build_input(uint8_t *buf,
+                            const SwitchOutReport *state,
+                            const ProconImuSample *imu);
+
+bool procon_full_mode(void);
+
+// HD rumble data of one motor (4 bytes of a 0x01/0x10 report) folded into
+// a plain 0..255 magnitude, the larger of the high and low band amplitude.
+// The neutral frame 00 01 40 40 is 0.
+uint8_t procon_rumble_amplitude(const uint8_t *motor);
+
+// True when the next report is a 0x30 and the console enabled the IMU
+bool procon_wants_imu(void);
+
+#endif
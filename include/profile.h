@@ -0,0 +1,55 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "calib.h"
+
+// How mouse movement is delivered to the console
+typedef enum {
+	AIM_MODE_STICK = 0, // right stick deflection
+	AIM_MODE_GYRO,      // synthesized gyroscope samples (Pro Controller only)
+} AimMode;
+
+// Per player tuning. Written once at init from core1,
+// read from both cores afterwards. The turn curve is only
+// used and rewritten (by calibration) on core1.
+typedef struct {
+	AimMode aim_mode;
+	// gyro aiming: turn per mouse count, in millidegrees
+	uint16_t gyro_mdeg_per_count;
+	bool gyro_invert_y;
+	// stick aiming once the game's curve is calibrated: turn per mouse
+	// count, in millidegrees
+	uint16_t stick_mdeg_per_count;
+	TurnCurve turn_curve;
+	// forward keyboard and mouse to the native HID interfaces
+	// (SWITCH_HID_PASSTHROUGH builds) instead of mapping them to the pad
+	bool passthrough;
+} AdapterProfile;
+
+#ifndef PROFILE_DEFAULT_AIM_MODE
+#define PROFILE_DEFAULT_AIM_MODE AIM_MODE_STICK
+#endif
+
+#ifndef PROFILE_DEFAULT_PASSTHROUGH
+#define PROFILE_DEFAULT_PASSTHROUGH 0
+#endif
+
+#ifndef PROFILE_DEFAULT_GYRO_MDEG_PER_COUNT
+#define PROFILE_DEFAULT_GYRO_MDEG_PER_COUNT 50
+#endif
+
+#ifndef PROFILE_DEFAULT_STICK_MDEG_PER_COUNT
+#define PROFILE_DEFAULT_STICK_MDEG_PER_COUNT 50
+#endif
+
+void profile_init(void);
+const AdapterProfile *profile_get(void);
+
+// core1, from calibration. Lasts until power off, the profile is not
+// stored in flash.
+void profile_set_turn_curve(const TurnCurve *curve);
+
+#endif
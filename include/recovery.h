@@ -0,0 +1,79 @@
+#ifndef _RECOVERY_H_
+#define _RECOVERY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hardware watchdog and recovery after a reset.
+// core1 sends a heartbeat from a BTstack timer, core0 feeds the watchdog
+// from the USB loop, but only while that heartbeat keeps moving. A wedged
+// Bluetooth stack therefore resets the adapter just like a wedged USB
+// loop, in well under a second.
+// The slot binding of every connected device is mirrored into
+// uninitialized RAM as it changes, so it survives the reset. After a
+// watchdog reboot the bonds are kept instead of deleted, the USB warmup
+// is skipped, and reconnecting devices get their old slot back before
+// anything new can take it.
+
+// Hardware timeout, covers a hung core0
+#ifndef RECOVERY_WATCHDOG_MS
+#define RECOVERY_WATCHDOG_MS 250
+#endif
+
+#ifndef RECOVERY_HEARTBEAT_MS
+#define RECOVERY_HEARTBEAT_MS 50
+#endif
+
+// core1 silent for this long counts as hung
+#ifndef RECOVERY_CORE1_TIMEOUT_MS
+#define RECOVERY_CORE1_TIMEOUT_MS 400
+#endif
+
+// First heartbeat deadline, CYW43 firmware load and Bluepad32 init included
+#ifndef RECOVERY_CORE1_BOOT_MS
+#define RECOVERY_CORE1_BOOT_MS 5000
+#endif
+
+// STAT_WATCHDOG_CAUSE
+enum {
+	RECOVERY_CAUSE_NONE,
+	RECOVERY_CAUSE_CORE0, // watchdog not fed, USB loop hung
+	RECOVERY_CAUSE_CORE1, // core0 stopped feeding, Bluetooth hung
+};
+
+// recovery_saved_device() flags
+#define RECOVERY_LEFT_STICK 0x01 // second mouse of the slot
+
+extern volatile uint32_t recovery_core1_beats;
+
+// core0, in main() before core1 is launched. Starts the watchdog.
+void recovery_init(void);
+
+// Whether this boot follows a watchdog reset, valid after recovery_init()
+bool recovery_after_watchdog(void);
+
+// core0, every USB loop iteration
+void recovery_core0_poll(void);
+
+// core0, once when the host has configured the device
+void recovery_usb_mounted(void);
+
+// core1, starts the heartbeat timer on the BTstack run loop
+void recovery_start(void);
+
+// core1, outside the BTstack run loop (load generator)
+static inline void
+recovery_core1_beat(void)
+{
+	recovery_core1_beats++;
+}
+
+// core1: device bindings, by Bluetooth address
+void recovery_save_device(const uint8_t addr[6], uint8_t slot, uint8_t flags);
+void recovery_forget_device(const uint8_t addr[6]);
+bool recovery_saved_device(const uint8_t addr[6], uint8_t *slot, uint8_t *flags);
+
+// core1, from on_controller_data
+void recovery_on_report(const uint8_t addr[6]);
+
+#endif
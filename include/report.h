@@ -1,10 +1,34 @@
 #ifndef _REPORT_H_
 #define _REPORT_H_
 
+#include <stdbool.h>
+
 #include "usb.h"
 #include "SwitchDescriptors.h"
 
+// Stamps time_us on the shared copy, the USB side measures report age with it
 void set_global_gamepad_report(SwitchIdxOutReport *rpt);
 void get_global_gamepad_report(SwitchIdxOutReport *rpt);
 
+// Raw mouse counts, accumulated until the USB side takes them
+typedef struct {
+    int32_t dx;
+    int32_t dy;
+    int32_t wheel;
+    uint8_t buttons;
+} MouseMotion;
+
+void add_global_mouse_motion(int32_t dx, int32_t dy, int32_t wheel, uint8_t buttons);
+void take_global_mouse_motion(MouseMotion *motion);
+
+// Boot protocol keyboard state for the passthrough interface
+typedef struct {
+    uint8_t modifiers;
+    uint8_t keys[6];
+} PassthroughKeyboard;
+
+void set_global_keyboard_report(const PassthroughKeyboard *kbd);
+// Returns true if the state changed since the last call
+bool get_global_keyboard_report(PassthroughKeyboard *kbd);
+
 #endif
\ No newline at end of file
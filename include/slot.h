@@ -0,0 +1,42 @@
+#ifndef _SLOT_H_
+#define _SLOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "SwitchDescriptors.h"
+
+// Several input devices feeding one player slot (pad).
+// Every device keeps its own contribution, a full SwitchOutReport; the
+// slot report is their merge:
+//   buttons  OR of all devices
+//   sticks   sum of the offsets from center, clamped
+//   hat      the lowest device index with a direction wins
+// Updates are incremental (per-button press counts, running axis sums and
+// a hat priority mask), so an event costs the same however many devices
+// share the slot. Pure logic, no SDK calls.
+
+#define SLOT_COUNT 4
+#define SLOT_MAX_DEVICES 32
+#define SLOT_NONE 0xFF
+
+void slot_init(void);
+
+// Device joins a slot with a neutral contribution; rebinding moves it
+void slot_bind(uint8_t device, uint8_t slot);
+
+// Removes the device and its contribution, returns its old slot or SLOT_NONE
+uint8_t slot_unbind(uint8_t device);
+
+// Slot of a device, SLOT_NONE if unbound
+uint8_t slot_of(uint8_t device);
+
+// Replaces the device's contribution, returns its slot (SLOT_NONE if unbound)
+uint8_t slot_update(uint8_t device, const SwitchOutReport *contribution);
+
+// Number of bound devices of a slot
+uint8_t slot_device_count(uint8_t slot);
+
+const SwitchOutReport *slot_report(uint8_t slot);
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+
+// Runtime counters, readable over USB as feature reports (see usb.h for
+// the interface): report ID STATS_REPORT_ID + n returns page n,
+// STATS_PER_PAGE little-endian uint32 counters each. tools/stats.py decodes them.
+// Each counter has a single writer core, so plain increments are safe.
+// Append new counters at the end, the host tool relies on the order.
+
+// Publish-to-collect age histogram, bucket n counts ages below
+// USB_AGE_BUCKET0_US << n, the last one everything older
+#define USB_AGE_BUCKETS 8
+#define USB_AGE_BUCKET0_US 250
+
+// Per link block, one per Bluetooth device slot (link.c)
+#define LINK_STAT_SLOTS 4
+enum {
+	LINK_STAT_ADDR,         // low 4 bytes of the device address
+	LINK_STAT_PROTOCOL,     // 0 free, 1 classic, 2 BLE
+	LINK_STAT_INTERVAL_US,  // BLE connection interval, or classic sniff interval (0 = active)
+	LINK_STAT_LATENCY,      // BLE peripheral latency
+	LINK_STAT_PARAM_REJECTS, // BLE interval requests refused
+	LINK_STAT_SNIFF_ENTRIES, // times the classic link went into sniff
+	LINK_STAT_RSSI,         // dBm, signed
+	LINK_STAT_REPORTS,      // input reports received
+	LINK_STAT_REPORT_INTERVAL_US, // smoothed report interval while streaming
+	LINK_STAT_JITTER_US,    // smoothed report interval variation
+	LINK_STAT_MAX_GAP_US,   // longest gap while streaming
+	LINK_STAT_FIELDS
+};
+
+enum {
+	STAT_HOST_OUT_RECEIVED,  // OUT reports from the console
+	STAT_HOST_OUT_FORWARDED, // coalesced states applied to BT devices
+	STAT_HOST_OUT_DEVICE_WRITES, // LED/rumble requests sent to devices
+	STAT_BOOT_REPORTS,       // reports decoded by the boot fast path
+	STAT_BOOT_CYCLES,        // core1 cycles spent in those decodes
+	STAT_GENERIC_REPORTS,    // reports through Bluepad32's generic parser
+	STAT_GENERIC_CYCLES,     // cycles from init_report to on_controller_data
+	STAT_LINK_FIRST,         // LINK_STAT_SLOTS blocks, see STAT_LINK()
+	STAT_LINK_LAST = STAT_LINK_FIRST + LINK_STAT_SLOTS * LINK_STAT_FIELDS - 1,
+	STAT_STACK0_SIZE,        // bytes, core0 (USB) stack
+	STAT_STACK0_PEAK,        // bytes, deepest core0 stack use
+	STAT_STACK1_SIZE,        // bytes, core1 (Bluetooth) stack
+	STAT_STACK1_PEAK,        // bytes, deepest core1 stack use
+	STAT_HEAP_ARENA,         // bytes taken from the heap region
+	STAT_HEAP_PEAK,          // bytes, most allocated at once
+	STAT_HCI_CONNECTIONS_PEAK, // most ACL links open at once
+	STAT_BT_DEVICES_PEAK,    // most Bluepad32 devices connected at once
+	STAT_USB_IN_REPORTS,     // gamepad reports collected by the host
+	STAT_USB_AGE_AVG_US,     // smoothed publish-to-collect age
+	STAT_USB_AGE_MAX_US,
+	STAT_USB_INTERVAL_AVG_US, // smoothed time between collected reports
+	STAT_USB_JITTER_US,      // smoothed variation of that interval
+	STAT_USB_INTERVAL_MAX_US,
+	STAT_USB_LATE_SUBMITS,   // frames the deadline was missed, sent late
+	STAT_PUBLISH_SUPPRESSED, // mapped states equal to the last published one
+	STAT_USB_SUPPRESSED,     // unchanged HORI reports not sent
+	STAT_USB_KEEPALIVES,     // unchanged HORI reports re-sent
+	STAT_PUBLISH_OVERWRITTEN, // published states replaced before core0 read them
+	STAT_USB_AGE_HIST,       // USB_AGE_BUCKETS counters, see above
+	STAT_USB_AGE_HIST_LAST = STAT_USB_AGE_HIST + USB_AGE_BUCKETS - 1,
+	STAT_LOADGEN_EVENTS,     // loadgen build only: events generated
+	STAT_LOADGEN_RATE,       // events/s being attempted
+	STAT_LOADGEN_ACHIEVED_RATE, // events/s core1 actually produced
+	STAT_LOADGEN_MAX_RATE,   // highest rate without overwritten publishes
+	STAT_LOADGEN_MAP_CYCLES, // core1 cycles per on_controller_data call
+	STAT_WATCHDOG_RESETS,    // watchdog resets since power-on
+	STAT_WATCHDOG_CAUSE,     // RECOVERY_CAUSE_* of the last one
+	STAT_RECOVERY_USB_MS,    // hang to the host configuring the adapter again
+	STAT_RECOVERY_MS,        // hang to every previously bound device reporting again
+	STAT_MAP_CYCLES,         // core1 cycles, mapping one report up to its publish
+	STAT_MAP_CYCLES_MAX,
+	STAT_USB_SEND_CYCLES,    // core0 cycles, reading and queueing one report
+	STAT_USB_SEND_CYCLES_MAX,
+	STAT_XIP_ACCESSES,       // XIP cache accesses, both cores, per memstats interval
+	STAT_XIP_MISSES,         // of those, cache misses (a stall on the flash)
+	STAT_CALIB_PROBE,        // turn calibration probe being measured, 0 idle
+	STAT_CALIB_MAX_RATE_MDPS, // calibrated turn rate at full deflection, 0 none
+	STAT_BOOT_CYW43_INIT_MS, // cyw43_arch_init, radio firmware upload included
+	STAT_BOOT_BT_READY_MS,   // power on to Bluepad32 ready for devices
+	STAT_BOOT_USB_MOUNTED_MS, // power on to the host configuring the adapter
+	STAT_SCAN_ON,            // 1 while inquiry and page scan run
+	STAT_SCAN_STARTS,        // times scanning was turned on
+	STAT_ADMIT_REJECTED,     // discovered devices ignored, not a keyboard or mouse
+	STAT_MOUSE_JITTER_SCAN_US, // smoothed mouse report interval variation, scanning
+	STAT_MOUSE_JITTER_IDLE_US, // the same with scanning off
+	STAT_PLAYBACK_STATE,     // PLAYBACK_STATE_*
+	STAT_PLAYBACK_RECORDS,   // records released on the frame clock
+	STAT_PLAYBACK_DROPPED,   // raw input records core1 had no room for
+	STAT_USB_SUBMIT_OFFSET_US, // report queue time into the frame, learned from IN completions
+	STAT_COUNT
+};
+
+#define STAT_LINK(slot, field) (STAT_LINK_FIRST + (slot) * LINK_STAT_FIELDS + (field))
+
+#define STATS_REPORT_ID 0x40
+#define STATS_PER_PAGE 15
+#define STATS_PAGES 10 // declared in the diagnostics report descriptor
+
+extern volatile uint32_t adapter_stats[STAT_COUNT];
+
+#define STAT_INC(id) (adapter_stats[id]++)
+#define STAT_ADD(id, v) (adapter_stats[id] += (v))
+#define STAT_SET(id, v) (adapter_stats[id] = (v))
+#define STAT_MAX(id, v)                                                        \
+	do {                                                                   \
+		if ((v) > adapter_stats[id])                                   \
+			adapter_stats[id] = (v);                               \
+	} while (0)
+
+// Fills a feature report page, returns its length (0 if out of range)
+uint16_t stats_fill_page(uint8_t page, uint8_t *buf, uint16_t len);
+
+#endif
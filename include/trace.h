@@ -0,0 +1,72 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+// Timeline tracing across both cores.
+// Begin/end/instant events go into a per-core flight recorder ring,
+// stamped with the shared microsecond timer so the two cores line up.
+// The host freezes the rings (feature SET_REPORT TRACE_REPORT_ID),
+// drains them (feature GET_REPORT TRACE_REPORT_ID + core) and resumes;
+// tools/trace2chrome.py does that and writes Chrome/Perfetto JSON.
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Records per core, a power of two. 8 bytes each.
+// The RP2350 has twice the SRAM, enough for four busy pads.
+#ifndef TRACE_RING_SIZE
+#if PICO_RP2350
+#define TRACE_RING_SIZE 2048
+#else
+#define TRACE_RING_SIZE 512
+#endif
+#endif
+
+#define TRACE_REPORT_ID 0x3A // 0x3A core0, 0x3B core1
+
+// Keep in sync with EVENTS in tools/trace2chrome.py
+typedef enum {
+	TRACE_BT_PACKET,       // core1, input report from a device, arg: device slot
+	TRACE_MAP,             // core1, on_controller_data, arg: controller class
+	TRACE_PUBLISH,         // core1, report handed to core0, arg: pad
+	TRACE_USB_POLL,        // core0, tud_task()
+	TRACE_USB_SEND,        // core0, report queued on an IN endpoint, arg: instance
+	TRACE_USB_IN_COMPLETE, // core0, host picked the report up, arg: instance
+	TRACE_LOCK_WAIT,       // both, waiting for the shared report lock
+	TRACE_EVENT_COUNT
+} TraceEvent;
+
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END 'E'
+#define TRACE_PHASE_INSTANT 'i'
+
+typedef struct {
+	uint32_t time_us;
+	uint8_t event;
+	uint8_t phase;
+	uint16_t arg;
+} TraceRecord;
+
+// Host commands, first byte of the SET_REPORT payload
+#define TRACE_CMD_RESUME 0 // clear and record again
+#define TRACE_CMD_FREEZE 1 // stop recording, rewind the read cursors
+
+void trace_record(uint8_t event, uint8_t phase, uint16_t arg);
+void trace_control(uint8_t cmd);
+
+// Next records of a frozen ring: [count, 0, count * TraceRecord]
+uint16_t trace_fill_report(uint8_t core, uint8_t *buf, uint16_t len);
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(ev, arg) trace_record(ev, TRACE_PHASE_BEGIN, arg)
+#define TRACE_END(ev, arg) trace_record(ev, TRACE_PHASE_END, arg)
+#define TRACE_INSTANT(ev, arg) trace_record(ev, TRACE_PHASE_INSTANT, arg)
+#else
+#define TRACE_BEGIN(ev, arg) ((void) 0)
+#define TRACE_END(ev, arg) ((void) 0)
+#define TRACE_INSTANT(ev, arg) ((void) 0)
+#endif
+
+#endif
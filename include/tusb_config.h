@@ -99,14 +99,15 @@ extern "C"
 #endif
 
 //------------- CLASS -------------//
-#define CFG_TUD_HID 4
+#define CFG_TUD_HID 7 // gamepads, passthrough keyboard and mouse, diagnostics
 #define CFG_TUD_CDC 0
 #define CFG_TUD_MSC 0
 #define CFG_TUD_MIDI 0
 #define CFG_TUD_VENDOR 0
 
 // HID buffer size Should be sufficient to hold ID (if any) + Data
-#define CFG_TUD_HID_EP_BUFSIZE 16
+// Also bounds GET_REPORT replies, stats pages use the full 64 bytes
+#define CFG_TUD_HID_EP_BUFSIZE 64
 
 #ifdef __cplusplus
 }
@@ -1,6 +1,55 @@
 #ifndef _USB_H_
 #define _USB_H_
 
+// HID instances: the gamepads first, then the optional
+// boot keyboard and mouse of the passthrough configuration
+#if SWITCH_PERSONALITY_PROCON
+#define USB_HID_GAMEPADS 1
+#else
+#define USB_HID_GAMEPADS 4
+#endif
+
+#if SWITCH_HID_PASSTHROUGH
+#define USB_HID_KEYBOARD (USB_HID_GAMEPADS)
+#define USB_HID_MOUSE (USB_HID_GAMEPADS + 1)
+#define USB_HID_PASSTHROUGH 2
+#else
+#define USB_HID_PASSTHROUGH 0
+#endif
+
+// Diagnostics feature reports (stats.h, dlog.h, trace.h). The first
+// gamepad serves them too, but its descriptor cannot declare them (the
+// HORI report has no report ID), so only hosts that pass undeclared
+// reports through (Linux hidraw) read them there. ADAPTER_DIAG_INTERFACE
+// adds a vendor interface that declares them, for hidapi on Windows and
+// macOS.
+#if ADAPTER_DIAG_INTERFACE
+#define USB_HID_DIAG (USB_HID_GAMEPADS + USB_HID_PASSTHROUGH)
+#define USB_HID_COUNT (USB_HID_DIAG + 1)
+#else
+#define USB_HID_COUNT (USB_HID_GAMEPADS + USB_HID_PASSTHROUGH)
+#endif
+
+// Frame aligned submission: the latest report is read and queued
+// USB_SUBMIT_MARGIN_US before the host's IN token, so it picks up data
+// that is at most a fraction of a frame old. Where in the 1 ms frame the
+// token comes depends on the host controller; it is learned from the IN
+// completions, USB_SUBMIT_OFFSET_US into the frame is where it starts
+// (an IN token right at the start of the next frame).
+// 0 queues reports as soon as the endpoint is free.
+#ifndef USB_SUBMIT_OFFSET_US
+#define USB_SUBMIT_OFFSET_US 850
+#endif
+#ifndef USB_SUBMIT_MARGIN_US
+#define USB_SUBMIT_MARGIN_US 150
+#endif
+
+// Unchanged HORI reports are only re-sent this often (ms), 0 never re-sends.
+// The Pro Controller streams every frame regardless.
+#ifndef USB_KEEPALIVE_MS
+#define USB_KEEPALIVE_MS 50
+#endif
+
 void usb_core_task();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "admit.h"
+
+#include <pico/time.h>
+#include <btstack_run_loop.h>
+
+#include "stats.h"
+#include "dlog.h"
+
+// Class of Device, as Bluepad32 passes it: major class in bits 8-12,
+// keyboard and pointing flags in bits 6-7 of the minor class
+#define COD_MAJOR(cod) (((cod) >> 8) & 0x1F)
+#define COD_MAJOR_PERIPHERAL 0x05
+#define COD_MINOR_KEYBOARD 0x40
+#define COD_MINOR_POINTING 0x80
+#define COD_SUBTYPE(cod) (((cod) >> 2) & 0x0F)
+#define COD_SUBTYPE_JOYSTICK 0x01
+#define COD_SUBTYPE_GAMEPAD 0x02
+
+static int devices;
+static bool scanning;
+static bool window_open;
+static bool pairing;
+static bool chord_down;
+static btstack_timer_source_t window_timer;
+static btstack_timer_source_t pairing_timer;
+
+static void
+update(void)
+{
+	bool want;
+	if (devices >= ADMIT_MAX_DEVICES)
+		want = false;
+	else if (devices == 0)
+		want = true;
+	else
+		want = window_open || pairing;
+
+	if (want == scanning)
+		return;
+	scanning = want;
+	uni_bt_enable_new_connections_unsafe(want);
+	STAT_SET(STAT_SCAN_ON, want);
+	if (want)
+		STAT_INC(STAT_SCAN_STARTS);
+	DLOG("admit: scanning %d, %d devices", want, devices);
+}
+
+static void
+window_timer_cb(btstack_timer_source_t *ts)
+{
+	// alternate between a scan window and the pause after it
+	window_open = !window_open;
+	btstack_run_loop_set_timer(ts, window_open ? ADMIT_SCAN_WINDOW_MS
+	                                           : ADMIT_SCAN_PERIOD_MS - ADMIT_SCAN_WINDOW_MS);
+	btstack_run_loop_add_timer(ts);
+	update();
+}
+
+static void
+pairing_timer_cb(btstack_timer_source_t *ts)
+{
+	ARG_UNUSED(ts);
+	pairing = false;
+	update();
+}
+
+void
+admit_start(void)
+{
+	// Bluepad32 starts with new connections off
+	scanning = false;
+	btstack_run_loop_set_timer_handler(&window_timer, window_timer_cb);
+	btstack_run_loop_set_timer(&window_timer, ADMIT_SCAN_PERIOD_MS - ADMIT_SCAN_WINDOW_MS);
+	btstack_run_loop_add_timer(&window_timer);
+	btstack_run_loop_set_timer_handler(&pairing_timer, pairing_timer_cb);
+	update();
+}
+
+void
+admit_set_devices(int count)
+{
+	devices = count;
+	update();
+}
+
+uni_error_t
+admit_device_discovered(uint16_t cod)
+{
+	// BLE devices come without one, Bluepad32 checks their appearance
+	if (cod == 0)
+		return UNI_ERROR_SUCCESS;
+
+	if (COD_MAJOR(cod) == COD_MAJOR_PERIPHERAL) {
+		if (cod & (COD_MINOR_KEYBOARD | COD_MINOR_POINTING))
+			return UNI_ERROR_SUCCESS;
+#if ADMIT_GAMEPADS && !ADAPTER_KM_ONLY
+		if (COD_SUBTYPE(cod) == COD_SUBTYPE_JOYSTICK || COD_SUBTYPE(cod) == COD_SUBTYPE_GAMEPAD)
+			return UNI_ERROR_SUCCESS;
+#endif
+	}
+	STAT_INC(STAT_ADMIT_REJECTED);
+	DLOG("admit: ignoring device, CoD 0x%04x", cod);
+	return UNI_ERROR_IGNORE_DEVICE;
+}
+
+void
+admit_keyboard_event(uint8_t modifiers, const uint8_t *keys, int count)
+{
+	bool down = false;
+	if ((modifiers & ADMIT_PAIR_MODIFIERS) == ADMIT_PAIR_MODIFIERS) {
+		for (int i = 0; i < count; i++) {
+			if (keys[i] == ADMIT_PAIR_KEY)
+				down = true;
+		}
+	}
+	if (down && !chord_down && devices < ADMIT_MAX_DEVICES) {
+		pairing = true;
+		btstack_run_loop_remove_timer(&pairing_timer);
+		btstack_run_loop_set_timer(&pairing_timer, ADMIT_PAIRING_MS);
+		btstack_run_loop_add_timer(&pairing_timer);
+		update();
+	}
+	chord_down = down;
+}
+
+bool
+admit_scanning(void)
+{
+	return scanning;
+}
@@ -0,0 +1,250 @@
+#include "boot_layout.h"
+
+#include <string.h>
+
+// HID item types and tags
+#define HID_TYPE_MAIN 0
+#define HID_TYPE_GLOBAL 1
+#define HID_TYPE_LOCAL 2
+
+#define HID_MAIN_INPUT 0x8
+#define HID_GLOBAL_USAGE_PAGE 0x0
+#define HID_GLOBAL_REPORT_SIZE 0x7
+#define HID_GLOBAL_REPORT_ID 0x8
+#define HID_GLOBAL_REPORT_COUNT 0x9
+#define HID_LOCAL_USAGE 0x0
+#define HID_LOCAL_USAGE_MIN 0x1
+
+#define HID_FLAG_CONSTANT 0x01
+#define HID_FLAG_VARIABLE 0x02
+#define HID_FLAG_RELATIVE 0x04
+
+#define PAGE_GENERIC_DESKTOP 0x01
+#define PAGE_KEYBOARD 0x07
+#define PAGE_BUTTON 0x09
+
+#define USAGE_X 0x30
+#define USAGE_Y 0x31
+#define USAGE_WHEEL 0x38
+#define USAGE_LEFT_CONTROL 0xE0
+
+#define MAX_USAGES 8
+#define MAX_REPORT_IDS 8
+#define MAX_FIELDS 64 // per main item, far beyond any boot report
+#define NO_FIELD 0xFFFF
+
+// Bit positions found while walking, NO_FIELD if absent
+typedef struct {
+	uint16_t modifiers;
+	uint16_t keys;
+	uint8_t keys_count;
+	uint16_t buttons;
+	uint8_t buttons_count;
+	uint16_t x, y, wheel;
+	uint8_t axis_size;
+	bool relative;
+	int16_t report_id; // owner of the fields above, -1 none yet
+} Fields;
+
+static uint32_t
+item_value(const uint8_t *data, int size)
+{
+	uint32_t v = 0;
+	for (int i = 0; i < size; i++)
+		v |= (uint32_t) data[i] << (8 * i);
+	return v;
+}
+
+static bool
+claim(Fields *f, uint8_t report_id)
+{
+	if (f->report_id < 0)
+		f->report_id = report_id;
+	return f->report_id == report_id;
+}
+
+static void
+record_input(Fields *f, uint8_t report_id, uint16_t page, uint32_t flags,
+             uint32_t size, uint32_t count, uint16_t bit,
+             const uint16_t *usages, int n_usages, uint16_t usage_min)
+{
+	if (flags & HID_FLAG_CONSTANT)
+		return;
+
+	if (page == PAGE_KEYBOARD) {
+		if (!claim(f, report_id))
+			return;
+		if ((flags & HID_FLAG_VARIABLE) && size == 1 && usage_min == USAGE_LEFT_CONTROL) {
+			f->modifiers = bit;
+		} else if (!(flags & HID_FLAG_VARIABLE) && size == 8) {
+			f->keys = bit;
+			f->keys_count = count;
+		}
+	} else if (page == PAGE_BUTTON) {
+		if (!claim(f, report_id))
+			return;
+		if ((flags & HID_FLAG_VARIABLE) && size == 1) {
+			f->buttons = bit;
+			f->buttons_count = count;
+		}
+	} else if (page == PAGE_GENERIC_DESKTOP && (flags & HID_FLAG_VARIABLE)) {
+		if (count > MAX_FIELDS)
+			count = MAX_FIELDS;
+		for (uint32_t k = 0; k < count; k++) {
+			uint16_t usage;
+			if (n_usages)
+				usage = usages[k < (uint32_t) n_usages ? k : (uint32_t) n_usages - 1];
+			else
+				usage = usage_min + k;
+
+			uint16_t at = bit + k * size;
+			if (usage != USAGE_X && usage != USAGE_Y && usage != USAGE_WHEEL)
+				continue;
+			if (!claim(f, report_id))
+				return;
+
+			if (usage == USAGE_X) {
+				f->x = at;
+				f->axis_size = size;
+				f->relative = flags & HID_FLAG_RELATIVE;
+			} else if (usage == USAGE_Y) {
+				f->y = at;
+			} else if (size == 8) {
+				f->wheel = at;
+			}
+		}
+	}
+}
+
+bool
+boot_layout_from_descriptor(const uint8_t *desc, int len, BootLayout *out)
+{
+	Fields f = {NO_FIELD, NO_FIELD, 0, NO_FIELD, 0, NO_FIELD, NO_FIELD, NO_FIELD, 0, false, -1};
+	uint16_t page = 0;
+	uint32_t size = 0, count = 0;
+	uint8_t report_id = 0;
+	uint16_t usages[MAX_USAGES];
+	int n_usages = 0;
+	uint16_t usage_min = 0;
+
+	// running bit offset per report ID
+	uint8_t ids[MAX_REPORT_IDS] = {0};
+	uint16_t offsets[MAX_REPORT_IDS] = {0};
+	int n_ids = 1;
+	int cur = 0;
+
+	memset(out, 0, sizeof(*out));
+
+	for (int i = 0; i < len;) {
+		uint8_t prefix = desc[i];
+		if (prefix == 0xFE) {
+			// long item, never used by keyboards or mice
+			if (i + 1 >= len)
+				break;
+			i += 3 + desc[i + 1];
+			continue;
+		}
+
+		int item_size = prefix & 0x3;
+		if (item_size == 3)
+			item_size = 4;
+		int type = (prefix >> 2) & 0x3;
+		int tag = prefix >> 4;
+		if (i + 1 + item_size > len)
+			break;
+		uint32_t value = item_value(&desc[i + 1], item_size);
+		i += 1 + item_size;
+
+		if (type == HID_TYPE_GLOBAL) {
+			switch (tag) {
+			case HID_GLOBAL_USAGE_PAGE: page = value; break;
+			case HID_GLOBAL_REPORT_SIZE: size = value; break;
+			case HID_GLOBAL_REPORT_COUNT: count = value; break;
+			case HID_GLOBAL_REPORT_ID:
+				report_id = value;
+				for (cur = 0; cur < n_ids && ids[cur] != report_id; cur++)
+					;
+				if (cur == n_ids) {
+					if (n_ids == MAX_REPORT_IDS)
+						return false;
+					ids[n_ids] = report_id;
+					offsets[n_ids] = 0;
+					n_ids++;
+				}
+				break;
+			default: break;
+			}
+		} else if (type == HID_TYPE_LOCAL) {
+			if (tag == HID_LOCAL_USAGE && n_usages < MAX_USAGES)
+				usages[n_usages++] = value;
+			else if (tag == HID_LOCAL_USAGE_MIN)
+				usage_min = value;
+		} else if (type == HID_TYPE_MAIN) {
+			if (tag == HID_MAIN_INPUT) {
+				record_input(&f, report_id, page, value, size, count,
+				             offsets[cur], usages, n_usages, usage_min);
+				offsets[cur] += size * count;
+			}
+			// locals only live until the next main item
+			n_usages = 0;
+			usage_min = 0;
+		}
+	}
+
+	if (f.report_id < 0)
+		return false;
+	out->report_id = f.report_id;
+
+	if (f.modifiers == 0 && f.keys == 16 && f.keys_count >= 6) {
+		out->kind = BOOT_LAYOUT_KEYBOARD;
+		return true;
+	}
+
+	if (f.buttons == 0 && f.buttons_count <= 8 && f.x == 8 && f.y == 16 &&
+	    f.axis_size == 8 && f.relative) {
+		out->kind = BOOT_LAYOUT_MOUSE;
+		out->has_wheel = f.wheel == 24;
+		return true;
+	}
+
+	return false;
+}
+
+static const uint8_t *
+report_payload(const BootLayout *layout, const uint8_t *report, uint16_t *len)
+{
+	if (!layout->report_id)
+		return report;
+	if (*len < 1 || report[0] != layout->report_id)
+		return NULL; // another report of the device, nothing we map
+	(*len)--;
+	return report + 1;
+}
+
+bool
+boot_layout_keyboard(const BootLayout *layout, const uint8_t *report, uint16_t len,
+                     BootKeyboard *out)
+{
+	const uint8_t *r = report_payload(layout, report, &len);
+	if (!r || len < 8)
+		return false;
+
+	out->modifiers = r[0];
+	memcpy(out->keys, &r[2], sizeof(out->keys));
+	return true;
+}
+
+bool
+boot_layout_mouse(const BootLayout *layout, const uint8_t *report, uint16_t len,
+                  BootMouse *out)
+{
+	const uint8_t *r = report_payload(layout, report, &len);
+	if (!r || len < 3)
+		return false;
+
+	out->buttons = r[0];
+	out->x = (int8_t) r[1];
+	out->y = (int8_t) r[2];
+	out->wheel = (layout->has_wheel && len >= 4) ? (int8_t) r[3] : 0;
+	return true;
+}
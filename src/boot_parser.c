@@ -0,0 +1,121 @@
+#include "boot_parser.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "cycles.h"
+#include "stats.h"
+#include "dlog.h"
+#include "trace.h"
+
+static BootLayout layouts[CONFIG_BLUEPAD32_MAX_DEVICES];
+
+// generic path instrumentation
+static void (*generic_init_report[CONFIG_BLUEPAD32_MAX_DEVICES])(uni_hid_device_t *);
+static uint32_t generic_start[CONFIG_BLUEPAD32_MAX_DEVICES];
+static bool generic_timing[CONFIG_BLUEPAD32_MAX_DEVICES];
+
+// Bluepad32 returns -1 for a device it no longer knows
+static bool
+valid_idx(int idx)
+{
+	return idx >= 0 && idx < CONFIG_BLUEPAD32_MAX_DEVICES;
+}
+
+static void
+parse_boot_keyboard(uni_hid_device_t *d, const uint8_t *report, uint16_t len)
+{
+	uint32_t start = cycles_now();
+	int idx = uni_hid_device_get_idx_for_instance(d);
+	if (!valid_idx(idx))
+		return;
+	TRACE_INSTANT(TRACE_BT_PACKET, idx);
+	BootKeyboard boot;
+	if (!boot_layout_keyboard(&layouts[idx], report, len, &boot))
+		return;
+
+	uni_keyboard_t *kb = &d->controller.keyboard;
+	kb->modifiers = boot.modifiers;
+	for (int i = 0; i < UNI_KEYBOARD_PRESSED_KEYS_MAX; i++)
+		kb->pressed_keys[i] = i < 6 ? boot.keys[i] : 0;
+
+	STAT_INC(STAT_BOOT_REPORTS);
+	STAT_ADD(STAT_BOOT_CYCLES, cycles_since(start));
+}
+
+static void
+parse_boot_mouse(uni_hid_device_t *d, const uint8_t *report, uint16_t len)
+{
+	uint32_t start = cycles_now();
+	int idx = uni_hid_device_get_idx_for_instance(d);
+	if (!valid_idx(idx))
+		return;
+	TRACE_INSTANT(TRACE_BT_PACKET, idx);
+	BootMouse boot;
+	if (!boot_layout_mouse(&layouts[idx], report, len, &boot))
+		return;
+
+	uni_mouse_t *mouse = &d->controller.mouse;
+	mouse->buttons = boot.buttons;
+	mouse->delta_x = boot.x;
+	mouse->delta_y = boot.y;
+	mouse->scroll_wheel = boot.wheel;
+
+	STAT_INC(STAT_BOOT_REPORTS);
+	STAT_ADD(STAT_BOOT_CYCLES, cycles_since(start));
+}
+
+// First hook of the generic parse, the matching end is on_controller_data
+static void
+timed_init_report(uni_hid_device_t *d)
+{
+	int idx = uni_hid_device_get_idx_for_instance(d);
+	if (!valid_idx(idx))
+		return;
+	TRACE_INSTANT(TRACE_BT_PACKET, idx);
+	generic_start[idx] = cycles_now();
+	generic_timing[idx] = true;
+	if (generic_init_report[idx])
+		generic_init_report[idx](d);
+}
+
+void
+boot_parser_install(uni_hid_device_t *d)
+{
+	int idx = uni_hid_device_get_idx_for_instance(d);
+	if (!valid_idx(idx))
+		return;
+
+	uni_controller_class_t klass = d->controller.klass;
+	BootLayout layout;
+	bool boot = BOOT_FAST_PATH &&
+	            boot_layout_from_descriptor(d->hid_descriptor, d->hid_descriptor_len, &layout) &&
+	            ((klass == UNI_CONTROLLER_CLASS_KEYBOARD && layout.kind == BOOT_LAYOUT_KEYBOARD) ||
+	             (klass == UNI_CONTROLLER_CLASS_MOUSE && layout.kind == BOOT_LAYOUT_MOUSE));
+
+	generic_timing[idx] = false;
+	if (boot) {
+		layouts[idx] = layout;
+		// the decoder writes the whole state, no reset and no usage walk
+		d->report_parser.init_report = NULL;
+		d->report_parser.parse_usage = NULL;
+		d->report_parser.parse_input_report =
+		        layout.kind == BOOT_LAYOUT_KEYBOARD ? parse_boot_keyboard : parse_boot_mouse;
+		DLOG("boot fast path: device %d, kind %d", idx, layout.kind);
+	} else {
+		generic_init_report[idx] = d->report_parser.init_report;
+		d->report_parser.init_report = timed_init_report;
+	}
+}
+
+void
+boot_parser_report_done(uni_hid_device_t *d)
+{
+	int idx = uni_hid_device_get_idx_for_instance(d);
+	if (!valid_idx(idx) || !generic_timing[idx])
+		return;
+
+	generic_timing[idx] = false;
+	STAT_INC(STAT_GENERIC_REPORTS);
+	STAT_ADD(STAT_GENERIC_CYCLES, cycles_since(generic_start[idx]));
+}
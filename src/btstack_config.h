@@ -1,54 +1,70 @@
 #ifndef _PICO_BTSTACK_BTSTACK_CONFIG_H
 #define _PICO_BTSTACK_BTSTACK_CONFIG_H
 
+#include "sdkconfig.h"
+
+// Pools are sized for what the adapter does: a HID host for
+// CONFIG_BLUEPAD32_MAX_DEVICES devices, no audio, no serial profiles.
+// Check the peaks in tools/stats.py before lowering anything further.
+#define ADAPTER_BT_DEVICES CONFIG_BLUEPAD32_MAX_DEVICES
+
 // BTstack features that can be enabled
 #define ENABLE_LE_PERIPHERAL
 #define ENABLE_LE_CENTRAL
 #define ENABLE_L2CAP_LE_CREDIT_BASED_FLOW_CONTROL_MODE
-#define ENABLE_LOG_INFO
 #define ENABLE_LOG_ERROR
 #define ENABLE_PRINTF_HEXDUMP
-#define ENABLE_SCO_OVER_HCI
 
 // BTstack configuration. buffers, sizes, ...
 #define HCI_OUTGOING_PRE_BUFFER_SIZE 4
-#define HCI_ACL_PAYLOAD_SIZE (1691 + 4)
+// The CYW43 never sends more than HCI_HOST_ACL_PACKET_LEN per packet and
+// HID L2CAP PDUs are far smaller, 3-DH5 sized buffers only cost RAM (one
+// reassembly buffer per connection).
+#define HCI_ACL_PAYLOAD_SIZE (1021 + 4)
 #define HCI_ACL_CHUNK_SIZE_ALIGNMENT 4
-#define MAX_NR_AVDTP_CONNECTIONS 1
-#define MAX_NR_AVDTP_STREAM_ENDPOINTS 1
-#define MAX_NR_AVRCP_CONNECTIONS 2
-#define MAX_NR_BNEP_CHANNELS 1
-#define MAX_NR_BNEP_SERVICES 1
+#define MAX_NR_AVDTP_CONNECTIONS 0
+#define MAX_NR_AVDTP_STREAM_ENDPOINTS 0
+#define MAX_NR_AVRCP_CONNECTIONS 0
+#define MAX_NR_BNEP_CHANNELS 0
+#define MAX_NR_BNEP_SERVICES 0
 #define MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES 2
-#define MAX_NR_GATT_CLIENTS 1
-#define MAX_NR_HCI_CONNECTIONS 4
+#define MAX_NR_GATT_CLIENTS ADAPTER_BT_DEVICES
+#define MAX_NR_HCI_CONNECTIONS ADAPTER_BT_DEVICES
 #define MAX_NR_HID_HOST_CONNECTIONS 1
-#define MAX_NR_HIDS_CLIENTS 1
-#define MAX_NR_HFP_CONNECTIONS 1
-#define MAX_NR_L2CAP_CHANNELS 6
+#define MAX_NR_HIDS_CLIENTS ADAPTER_BT_DEVICES
+#define MAX_NR_HFP_CONNECTIONS 0
+// HID control + interrupt per classic device, plus SDP while pairing
+#define MAX_NR_L2CAP_CHANNELS (2 * ADAPTER_BT_DEVICES + 1)
 #define MAX_NR_L2CAP_SERVICES 5
-#define MAX_NR_RFCOMM_CHANNELS 1
-#define MAX_NR_RFCOMM_MULTIPLEXERS 1
-#define MAX_NR_RFCOMM_SERVICES 1
+#define MAX_NR_RFCOMM_CHANNELS 0
+#define MAX_NR_RFCOMM_MULTIPLEXERS 0
+#define MAX_NR_RFCOMM_SERVICES 0
 #define MAX_NR_SERVICE_RECORD_ITEMS 4
 #define MAX_NR_SM_LOOKUP_ENTRIES 3
-#define MAX_NR_WHITELIST_ENTRIES 16
-#define MAX_NR_LE_DEVICE_DB_ENTRIES 16
+#define MAX_NR_WHITELIST_ENTRIES ADAPTER_BT_DEVICES
+#define MAX_NR_LE_DEVICE_DB_ENTRIES ADAPTER_BT_DEVICES
 
 // Limit number of ACL/SCO Buffer to use by stack to avoid cyw43 shared bus overrun
 #define MAX_NR_CONTROLLER_ACL_BUFFERS 3
-#define MAX_NR_CONTROLLER_SCO_PACKETS 3
+#define MAX_NR_CONTROLLER_SCO_PACKETS 0
 
 // Enable and configure HCI Controller to Host Flow Control to avoid cyw43 shared bus overrun
 #define ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
 #define HCI_HOST_ACL_PACKET_LEN 1024
 #define HCI_HOST_ACL_PACKET_NUM 3
-#define HCI_HOST_SCO_PACKET_LEN 120
-#define HCI_HOST_SCO_PACKET_NUM 3
+#define HCI_HOST_SCO_PACKET_LEN 0
+#define HCI_HOST_SCO_PACKET_NUM 0
 
-// Link Key DB and LE Device DB using TLV on top of Flash Sector interface
-#define NVM_NUM_DEVICE_DB_ENTRIES 16
-#define NVM_NUM_LINK_KEYS 16
+// Link Key DB and LE Device DB using TLV on top of Flash Sector interface.
+// Keys are wiped on a normal boot (on_init_complete) but kept across a
+// watchdog reset, so the devices that were playing reconnect (recovery.h).
+// Between boots a device can leave and another pair in its place while
+// the old bond stays stored; a full table replaces the oldest entry,
+// which may belong to a device still connected and then lost after the
+// next reset. Room for twice the devices keeps those bonds, an entry is
+// a few dozen bytes of the 8 KB flash bank.
+#define NVM_NUM_DEVICE_DB_ENTRIES (2 * ADAPTER_BT_DEVICES)
+#define NVM_NUM_LINK_KEYS (2 * ADAPTER_BT_DEVICES)
 
 // We don't give btstack a malloc, so use a fixed-size ATT DB.
 #define MAX_ATT_DB_SIZE 512
@@ -0,0 +1,228 @@
+#include "calib.h"
+
+#include <string.h>
+
+#include "profile.h"
+#include "hot.h"
+
+// Shorter holds are taken as a slip of the finger
+#define CALIB_MIN_HOLD_MS 100
+#define CALIB_FULL_TURN_MDEG 360000u
+
+static bool active;
+static int probe;
+static bool holding;
+static uint32_t hold_start_ms;
+static uint32_t rates[CALIB_PROBES];
+static uint8_t prev_keys[6];
+
+// Pool adjacent violators: the least squares non-decreasing fit, so one
+// badly timed turn bends the curve a little instead of folding it
+static void
+make_monotone(uint32_t *r, int n)
+{
+	uint64_t sum[CALIB_PROBES];
+	int count[CALIB_PROBES];
+	int blocks = 0;
+
+	for (int i = 0; i < n; i++) {
+		sum[blocks] = r[i];
+		count[blocks] = 1;
+		blocks++;
+		while (blocks > 1 &&
+		       sum[blocks - 2] * count[blocks - 1] > sum[blocks - 1] * count[blocks - 2]) {
+			sum[blocks - 2] += sum[blocks - 1];
+			count[blocks - 2] += count[blocks - 1];
+			blocks--;
+		}
+	}
+
+	int i = 0;
+	for (int b = 0; b < blocks; b++) {
+		for (int k = 0; k < count[b]; k++)
+			r[i++] = sum[b] / count[b];
+	}
+}
+
+bool
+calib_fit(const uint16_t *deflection, const uint32_t *rate_mdps, int n, TurnCurve *out)
+{
+	if (n < 1 || n > CALIB_PROBES)
+		return false;
+
+	// the center never turns
+	uint16_t d[CALIB_PROBES + 1] = {0};
+	uint32_t r[CALIB_PROBES + 1] = {0};
+	memcpy(&d[1], deflection, n * sizeof(d[0]));
+	memcpy(&r[1], rate_mdps, n * sizeof(r[0]));
+	make_monotone(&r[1], n);
+
+	uint32_t max = r[n];
+	if (!max)
+		return false;
+
+	// the last deflection that did not turn is the dead zone edge
+	int k = 1;
+	while (r[k] == 0)
+		k++;
+
+	// walk the measured response and invert it piecewise linearly,
+	// r[k - 1] < target <= r[k] holds at every step
+	out->max_rate_mdps = max;
+	for (int j = 0; j < CALIB_LUT_SIZE; j++) {
+		uint32_t target = (uint64_t) max * j / (CALIB_LUT_SIZE - 1);
+		while (r[k] < target)
+			k++;
+
+		uint32_t v = d[k - 1] + (uint64_t) (d[k] - d[k - 1]) * (target - r[k - 1]) /
+		                                (r[k] - r[k - 1]);
+		out->lut[j] = v > CALIB_FULL_DEFLECTION ? CALIB_FULL_DEFLECTION : v;
+	}
+	return true;
+}
+
+int32_t
+calib_deflection(const TurnCurve *curve, int32_t rate_mdps)
+{
+	if (!rate_mdps || !curve->max_rate_mdps)
+		return 0;
+
+	uint32_t rate = rate_mdps < 0 ? -(uint32_t) rate_mdps : (uint32_t) rate_mdps;
+	int32_t d;
+	if (rate >= curve->max_rate_mdps) {
+		d = CALIB_FULL_DEFLECTION;
+	} else {
+#if ADAPTER_FPU
+		// single precision on the FPU, no 64-bit division
+		float pos = (float) rate * (CALIB_LUT_SIZE - 1) / curve->max_rate_mdps;
+		uint32_t i = (uint32_t) pos;
+		if (i > CALIB_LUT_SIZE - 2)
+			i = CALIB_LUT_SIZE - 2; // rate just below max rounded up
+		float f = pos - i;
+		d = curve->lut[i] + (int32_t) (((int32_t) curve->lut[i + 1] - curve->lut[i]) * f);
+#else
+		// table position with 16 fractional bits, a step between two
+		// entries can span most of the stick
+		uint32_t pos = (uint64_t) rate * ((CALIB_LUT_SIZE - 1) << 16) / curve->max_rate_mdps;
+		uint32_t i = pos >> 16;
+		int32_t f = pos & 0xFFFF;
+		d = curve->lut[i] + ((((int32_t) curve->lut[i + 1] - curve->lut[i]) * f) >> 16);
+#endif
+	}
+	return rate_mdps < 0 ? -d : d;
+}
+
+int32_t
+HOT_FN(calib_mouse_deflection)(const TurnCurve *curve, uint16_t mdeg_per_count,
+                               int32_t delta, uint32_t interval_us)
+{
+#if ADAPTER_FPU
+	// largest float below 2^31, converts without overflow
+	const float limit = 2147483520.0f;
+	float rate = (float) delta * mdeg_per_count * (1000000.0f / interval_us);
+	if (rate > limit)
+		rate = limit;
+	else if (rate < -limit)
+		rate = -limit;
+#else
+	// a product past INT64_MAX / 1000000 saturates at any interval
+	int64_t rate = (int64_t) delta * mdeg_per_count;
+	if (rate > INT64_MAX / 1000000)
+		rate = INT32_MAX;
+	else if (rate < -INT64_MAX / 1000000)
+		rate = -INT32_MAX;
+	else
+		rate = rate * 1000000 / interval_us;
+	if (rate > INT32_MAX)
+		rate = INT32_MAX;
+	else if (rate < -INT32_MAX)
+		rate = -INT32_MAX;
+#endif
+	return calib_deflection(curve, (int32_t) rate);
+}
+
+static uint16_t
+probe_deflection(int i)
+{
+	return CALIB_FULL_DEFLECTION * (i + 1) / CALIB_PROBES;
+}
+
+static void
+record(uint32_t rate_mdps)
+{
+	rates[probe++] = rate_mdps;
+	if (probe < CALIB_PROBES)
+		return;
+
+	uint16_t deflection[CALIB_PROBES];
+	for (int i = 0; i < CALIB_PROBES; i++)
+		deflection[i] = probe_deflection(i);
+
+	TurnCurve curve;
+	if (calib_fit(deflection, rates, CALIB_PROBES, &curve))
+		profile_set_turn_curve(&curve);
+	active = false;
+}
+
+static bool
+was_pressed(uint8_t key)
+{
+	for (int i = 0; i < 6; i++) {
+		if (prev_keys[i] == key)
+			return true;
+	}
+	return false;
+}
+
+bool
+calib_keyboard_event(SwitchOutReport *out, const uint8_t *keys, int count, uint32_t now_ms)
+{
+	uint8_t now[6] = {0};
+	int n = 0;
+	bool hold_down = false;
+
+	for (int i = 0; i < count && n < 6; i++) {
+		uint8_t key = keys[i];
+		if (!key)
+			continue;
+		now[n++] = key;
+		if (key == CALIB_HOLD_KEY)
+			hold_down = true;
+		if (was_pressed(key))
+			continue;
+
+		if (key == CALIB_TOGGLE_KEY) {
+			active = !active;
+			probe = 0;
+			holding = false;
+		} else if (active && !holding && key == CALIB_SKIP_KEY) {
+			record(0);
+		} else if (active && !holding && key == CALIB_BACK_KEY && probe > 0) {
+			probe--;
+		}
+	}
+	memcpy(prev_keys, now, sizeof(prev_keys));
+
+	if (!active)
+		return false;
+
+	if (hold_down && !holding) {
+		holding = true;
+		hold_start_ms = now_ms;
+	} else if (!hold_down && holding) {
+		holding = false;
+		uint32_t ms = now_ms - hold_start_ms;
+		if (ms >= CALIB_MIN_HOLD_MS)
+			record(CALIB_FULL_TURN_MDEG * 1000ull / ms);
+	}
+
+	if (holding)
+		out->rx = SWITCH_STICK_MID + probe_deflection(probe);
+	return true;
+}
+
+int
+calib_probe(void)
+{
+	return active ? probe + 1 : 0;
+}
@@ -0,0 +1,51 @@
+#include "dedup.h"
+
+#include <string.h>
+
+#include "hot.h"
+
+static bool
+HOT_FN(same_report)(const SwitchOutReport *a, const SwitchOutReport *b)
+{
+	return a->buttons == b->buttons && a->hat == b->hat &&
+	       a->lx == b->lx && a->ly == b->ly && a->rx == b->rx && a->ry == b->ry;
+}
+
+bool
+HOT_FN(dedup_publish)(PublishDedup *d, const SwitchIdxOutReport *src)
+{
+	if (src->idx >= USB_HID_GAMEPADS)
+		return true;
+	if (d->published_once[src->idx] && same_report(&d->published[src->idx], &src->report))
+		return false;
+	d->published[src->idx] = src->report;
+	d->published_once[src->idx] = true;
+	return true;
+}
+
+void
+HOT_FN(dedup_overwritten)(PublishDedup *d, uint8_t unread_idx, uint8_t idx)
+{
+	if (unread_idx != idx && unread_idx < USB_HID_GAMEPADS)
+		d->published_once[unread_idx] = false;
+}
+
+DedupSend
+HOT_FN(dedup_send)(const SendDedup *d, uint8_t idx, const SwitchReport *out, uint32_t now_ms)
+{
+	if (!d->sent_once[idx] || memcmp(out, &d->last_sent[idx], sizeof(*out)) != 0)
+		return DEDUP_SEND;
+	if (USB_KEEPALIVE_MS == 0 || now_ms - d->last_sent_ms[idx] < USB_KEEPALIVE_MS)
+		return DEDUP_SUPPRESS;
+	return DEDUP_KEEPALIVE;
+}
+
+void
+HOT_FN(dedup_queued)(SendDedup *d, uint8_t idx, const SwitchReport *out, uint32_t now_ms, bool ok)
+{
+	if (!ok)
+		return;
+	d->last_sent[idx] = *out;
+	d->last_sent_ms[idx] = now_ms;
+	d->sent_once[idx] = true;
+}
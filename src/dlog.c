@@ -0,0 +1,71 @@
+#include "dlog.h"
+
+#include <string.h>
+
+#include <pico/platform.h>
+#include <pico/time.h>
+
+typedef struct {
+	volatile uint32_t head; // written by the logging core
+	volatile uint32_t tail; // written by the USB side
+	volatile uint32_t dropped;
+	uint32_t dropped_reported;
+	DlogRecord records[DLOG_RING_SIZE];
+} DlogRing;
+
+static DlogRing rings[2];
+
+void
+dlog_write(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+	DlogRing *r = &rings[get_core_num()];
+	uint32_t head = r->head;
+
+	// full: keep the older records, they explain how we got here
+	if (head - r->tail >= DLOG_RING_SIZE) {
+		r->dropped++;
+		return;
+	}
+
+	DlogRecord *rec = &r->records[head & (DLOG_RING_SIZE - 1)];
+	rec->fmt = (uint32_t) (uintptr_t) fmt;
+	rec->time_us = time_us_32();
+	rec->args[0] = a0;
+	rec->args[1] = a1;
+	rec->args[2] = a2;
+	rec->args[3] = a3;
+
+	__dmb();
+	r->head = head + 1;
+}
+
+uint16_t
+dlog_fill_report(uint8_t core, uint8_t *buf, uint16_t len)
+{
+	if (core > 1 || len < 2)
+		return 0;
+
+	DlogRing *r = &rings[core];
+	uint32_t tail = r->tail;
+	uint32_t avail = r->head - tail;
+	__dmb();
+
+	uint32_t n = (len - 2) / sizeof(DlogRecord);
+	if (n > avail)
+		n = avail;
+
+	uint32_t dropped = r->dropped;
+	uint32_t lost = dropped - r->dropped_reported;
+	r->dropped_reported = dropped;
+
+	buf[0] = n;
+	buf[1] = lost > 0xFF ? 0xFF : lost;
+	for (uint32_t i = 0; i < n; i++)
+		memcpy(&buf[2 + i * sizeof(DlogRecord)],
+		       &r->records[(tail + i) & (DLOG_RING_SIZE - 1)], sizeof(DlogRecord));
+
+	__dmb();
+	r->tail = tail + n;
+
+	return 2 + n * sizeof(DlogRecord);
+}
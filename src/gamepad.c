@@ -0,0 +1,106 @@
+#include "gamepad.h"
+
+#include "hot.h"
+
+// Left out with the rest of the gamepad support, the table is 2 KB
+#if !ADAPTER_KM_ONLY
+
+static uint16_t axis_lut[GAMEPAD_AXIS_COUNT];
+
+// DPAD_* bitmask to hat, impossible combinations read as centered
+static const uint8_t HOT_DATA(dpad_to_hat)[16] = {
+	[0] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_UP] = SWITCH_HAT_UP,
+	[GAMEPAD_DPAD_DOWN] = SWITCH_HAT_DOWN,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_DOWN] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_RIGHT] = SWITCH_HAT_RIGHT,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_RIGHT] = SWITCH_HAT_UPRIGHT,
+	[GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_RIGHT] = SWITCH_HAT_DOWNRIGHT,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_RIGHT] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_LEFT] = SWITCH_HAT_LEFT,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_UPLEFT,
+	[GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_DOWNLEFT,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_RIGHT | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_RIGHT | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_RIGHT | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_NOTHING,
+	[GAMEPAD_DPAD_UP | GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_RIGHT | GAMEPAD_DPAD_LEFT] = SWITCH_HAT_NOTHING,
+};
+
+typedef struct {
+	uint16_t bluepad;
+	uint16_t switch_mask;
+} ButtonMap;
+
+static const ButtonMap HOT_DATA(gamepad_buttons)[] = {
+	{GAMEPAD_BUTTON_A, SWITCH_MASK_A},
+	{GAMEPAD_BUTTON_B, SWITCH_MASK_B},
+	{GAMEPAD_BUTTON_X, SWITCH_MASK_X},
+	{GAMEPAD_BUTTON_Y, SWITCH_MASK_Y},
+	{GAMEPAD_BUTTON_SHOULDER_L, SWITCH_MASK_L},
+	{GAMEPAD_BUTTON_SHOULDER_R, SWITCH_MASK_R},
+	{GAMEPAD_BUTTON_TRIGGER_L, SWITCH_MASK_ZL},
+	{GAMEPAD_BUTTON_TRIGGER_R, SWITCH_MASK_ZR},
+	{GAMEPAD_BUTTON_THUMB_L, SWITCH_MASK_L3},
+	{GAMEPAD_BUTTON_THUMB_R, SWITCH_MASK_R3},
+};
+
+static const ButtonMap HOT_DATA(gamepad_misc_buttons)[] = {
+	{GAMEPAD_MISC_SYSTEM, SWITCH_MASK_HOME},
+	{GAMEPAD_MISC_CAPTURE, SWITCH_MASK_CAPTURE},
+	{GAMEPAD_MISC_SELECT, SWITCH_MASK_MINUS},
+	{GAMEPAD_MISC_START, SWITCH_MASK_PLUS},
+};
+
+void
+gamepad_init(void)
+{
+	for (int i = 0; i < GAMEPAD_AXIS_COUNT; i++) {
+		int v = i * 4; // 0..4092
+		if (v > SWITCH_STICK_MAX)
+			v = SWITCH_STICK_MAX;
+		if (v > SWITCH_STICK_MID - GAMEPAD_AXIS_DEADZONE &&
+		    v < SWITCH_STICK_MID + GAMEPAD_AXIS_DEADZONE)
+			v = SWITCH_STICK_MID;
+		axis_lut[i] = (uint16_t) v;
+	}
+}
+
+uint16_t
+HOT_FN(gamepad_axis)(int32_t axis)
+{
+	uint32_t i = (uint32_t) (axis - GAMEPAD_AXIS_MIN);
+	if (i >= GAMEPAD_AXIS_COUNT)
+		return axis < 0 ? SWITCH_STICK_MIN : SWITCH_STICK_MAX;
+	return axis_lut[i];
+}
+
+void
+HOT_FN(gamepad_fill)(SwitchOutReport *out, const GamepadState *gp)
+{
+	uint16_t buttons = 0;
+
+	for (unsigned i = 0; i < sizeof(gamepad_buttons) / sizeof(gamepad_buttons[0]); i++) {
+		if (gp->buttons & gamepad_buttons[i].bluepad)
+			buttons |= gamepad_buttons[i].switch_mask;
+	}
+	for (unsigned i = 0; i < sizeof(gamepad_misc_buttons) / sizeof(gamepad_misc_buttons[0]); i++) {
+		if (gp->misc_buttons & gamepad_misc_buttons[i].bluepad)
+			buttons |= gamepad_misc_buttons[i].switch_mask;
+	}
+
+	// analog triggers
+	if (gp->brake)
+		buttons |= SWITCH_MASK_ZL;
+	if (gp->throttle)
+		buttons |= SWITCH_MASK_ZR;
+
+	out->buttons |= buttons;
+	out->hat = dpad_to_hat[gp->dpad & 0x0F];
+	out->lx = gamepad_axis(gp->axis_x);
+	out->ly = gamepad_axis(gp->axis_y);
+	out->rx = gamepad_axis(gp->axis_rx);
+	out->ry = gamepad_axis(gp->axis_ry);
+}
+
+#endif
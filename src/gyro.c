@@ -0,0 +1,60 @@
+#include "gyro.h"
+
+#include "profile.h"
+
+// Pro Controller axes: X roll, Y pitch, Z yaw.
+// Mouse right turns right (negative yaw), mouse down looks down.
+#define GYRO_AXIS_PITCH 1
+#define GYRO_AXIS_YAW 2
+#define GYRO_YAW_SIGN (-1)
+#define GYRO_PITCH_SIGN (-1)
+
+// angle not yet sent, in udeg
+static int64_t residual_yaw;
+static int64_t residual_pitch;
+
+void
+gyro_reset(void)
+{
+	residual_yaw = 0;
+	residual_pitch = 0;
+}
+
+static int16_t
+quantize(int64_t *residual)
+{
+	int64_t lsb = *residual / GYRO_UDEG_PER_LSB_SAMPLE;
+	if (lsb > INT16_MAX)
+		lsb = INT16_MAX;
+	else if (lsb < INT16_MIN)
+		lsb = INT16_MIN;
+
+	// whatever does not fit in this sample goes out with the next one
+	*residual -= lsb * GYRO_UDEG_PER_LSB_SAMPLE;
+	return (int16_t) lsb;
+}
+
+void
+gyro_synthesize(int32_t dx, int32_t dy, ProconImuSample out[PROCON_IMU_SAMPLES])
+{
+	const AdapterProfile *profile = profile_get();
+	int64_t scale = (int64_t) profile->gyro_mdeg_per_count * 1000;
+	int64_t yaw = GYRO_YAW_SIGN * dx * scale;
+	int64_t pitch = GYRO_PITCH_SIGN * dy * scale;
+	if (profile->gyro_invert_y)
+		pitch = -pitch;
+
+	for (int i = 0; i < PROCON_IMU_SAMPLES; i++) {
+		// sample i gets its share of the motion since the last report
+		residual_yaw += yaw * (i + 1) / PROCON_IMU_SAMPLES - yaw * i / PROCON_IMU_SAMPLES;
+		residual_pitch += pitch * (i + 1) / PROCON_IMU_SAMPLES - pitch * i / PROCON_IMU_SAMPLES;
+
+		ProconImuSample *s = &out[i];
+		s->accel[0] = 0;
+		s->accel[1] = 0;
+		s->accel[2] = GYRO_ACCEL_1G;
+		s->gyro[0] = 0;
+		s->gyro[GYRO_AXIS_PITCH] = quantize(&residual_pitch);
+		s->gyro[GYRO_AXIS_YAW] = quantize(&residual_yaw);
+	}
+}
@@ -0,0 +1,149 @@
+#include "host_output.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <pico/platform.h>
+#include <btstack_run_loop.h>
+#include <uni.h>
+
+#include "procon.h"
+#include "sdkconfig.h"
+#include "stats.h"
+
+typedef struct {
+	uint8_t player_leds;
+	uint8_t rumble_weak;
+	uint8_t rumble_strong;
+} HostOutputState;
+
+// seqlock: odd while core0 is writing
+static volatile uint32_t mailbox_seq;
+static HostOutputState mailbox;
+
+// core0 side
+static HostOutputState latest;
+
+// core1 side
+static uint32_t applied_seq;
+static HostOutputState applied;
+static uint32_t rumble_sent_ms;
+static btstack_timer_source_t forward_timer;
+
+static void
+publish(const HostOutputState *s)
+{
+	if (memcmp(s, &latest, sizeof(latest)) == 0)
+		return;
+	latest = *s;
+
+	mailbox_seq++;
+	__dmb();
+	mailbox = *s;
+	__dmb();
+	mailbox_seq++;
+}
+
+void
+host_output_on_report(const uint8_t *buf, uint16_t len)
+{
+	STAT_INC(STAT_HOST_OUT_RECEIVED);
+
+#if SWITCH_PERSONALITY_PROCON
+	if (len < 10 || (buf[0] != 0x01 && buf[0] != 0x10))
+		return;
+
+	HostOutputState s = latest;
+	// [2..5] left motor, [6..9] right motor
+	s.rumble_strong = procon_rumble_amplitude(&buf[2]);
+	s.rumble_weak = procon_rumble_amplitude(&buf[6]);
+
+	// subcommand 0x30: player lights in the low nibble
+	if (buf[0] == 0x01 && len >= 12 && buf[10] == 0x30)
+		s.player_leds = buf[11] & 0x0F;
+
+	publish(&s);
+#else
+	// the HORI output report carries nothing the devices can show
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+#endif
+}
+
+static bool
+read_mailbox(HostOutputState *out, uint32_t *seq)
+{
+	uint32_t before, after;
+	do {
+		before = mailbox_seq;
+		__dmb();
+		*out = mailbox;
+		__dmb();
+		after = mailbox_seq;
+	} while (before != after || (before & 1));
+
+	*seq = before;
+	return before != applied_seq;
+}
+
+static void
+apply(const HostOutputState *s, bool leds, bool rumble)
+{
+	for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+		uni_hid_device_t *d = uni_hid_device_get_instance_for_idx(i);
+		if (!d || !uni_bt_conn_is_connected(&d->conn))
+			continue;
+
+		if (leds && d->report_parser.set_player_leds != NULL) {
+			d->report_parser.set_player_leds(d, s->player_leds);
+			STAT_INC(STAT_HOST_OUT_DEVICE_WRITES);
+		}
+
+		// runs past the next refresh, or stops it when both are 0
+		if (rumble && d->report_parser.play_dual_rumble != NULL) {
+			d->report_parser.play_dual_rumble(d, 0,
+			                                  HOST_OUTPUT_RUMBLE_REFRESH_MS * 2,
+			                                  s->rumble_weak, s->rumble_strong);
+			STAT_INC(STAT_HOST_OUT_DEVICE_WRITES);
+		}
+	}
+}
+
+static void
+forward_timer_cb(btstack_timer_source_t *ts)
+{
+	HostOutputState s;
+	uint32_t seq;
+
+	uint32_t now = btstack_run_loop_get_time_ms();
+
+	if (!read_mailbox(&s, &seq))
+		s = applied;
+	applied_seq = seq;
+
+	bool leds = s.player_leds != applied.player_leds;
+	bool rumble = s.rumble_weak != applied.rumble_weak ||
+	              s.rumble_strong != applied.rumble_strong;
+	bool rumbling = s.rumble_weak || s.rumble_strong;
+	if (rumbling && now - rumble_sent_ms >= HOST_OUTPUT_RUMBLE_REFRESH_MS)
+		rumble = true;
+
+	if (leds || rumble) {
+		apply(&s, leds, rumble);
+		applied = s;
+		if (rumble)
+			rumble_sent_ms = now;
+		STAT_INC(STAT_HOST_OUT_FORWARDED);
+	}
+
+	btstack_run_loop_set_timer(ts, HOST_OUTPUT_FORWARD_INTERVAL_MS);
+	btstack_run_loop_add_timer(ts);
+}
+
+void
+host_output_start(void)
+{
+	btstack_run_loop_set_timer_handler(&forward_timer, forward_timer_cb);
+	btstack_run_loop_set_timer(&forward_timer, HOST_OUTPUT_FORWARD_INTERVAL_MS);
+	btstack_run_loop_add_timer(&forward_timer);
+}
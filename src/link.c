@@ -0,0 +1,294 @@
+#include "link.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <pico/time.h>
+#include <btstack.h>
+#include <uni.h>
+
+#include "sdkconfig.h"
+#include "stats.h"
+#include "dlog.h"
+#include "admit.h"
+
+typedef struct {
+	bool used;
+	hci_con_handle_t handle;
+	uni_bt_conn_protocol_t protocol;
+
+	// pending work for the poll timer
+	bool want_policy;
+	bool want_unsniff;
+	bool want_update;
+	uint16_t ble_interval_max;
+
+	uint32_t last_report_us;
+	uint32_t last_interval_us;
+	uint32_t avg_interval_us;
+	uint32_t jitter_us; // x16, RFC 3550 style smoothing
+} Link;
+
+static Link links[LINK_STAT_SLOTS];
+static int rssi_next;
+static btstack_packet_callback_registration_t hci_event_cb;
+static btstack_timer_source_t poll_timer;
+
+// all mouse links together, x16, split by whether scanning was on
+static uint32_t mouse_jitter_scan;
+static uint32_t mouse_jitter_idle;
+
+#define LINK_SET(slot, field, v) STAT_SET(STAT_LINK(slot, field), (v))
+
+static int
+find_link(hci_con_handle_t handle)
+{
+	for (int i = 0; i < LINK_STAT_SLOTS; i++)
+		if (links[i].used && links[i].handle == handle)
+			return i;
+	return -1;
+}
+
+static void
+clear_link_stats(int slot)
+{
+	for (int f = 0; f < LINK_STAT_FIELDS; f++)
+		LINK_SET(slot, f, 0);
+}
+
+static void
+set_ble_interval(int slot, uint16_t interval, uint16_t latency)
+{
+	LINK_SET(slot, LINK_STAT_INTERVAL_US, interval * 1250u);
+	LINK_SET(slot, LINK_STAT_LATENCY, latency);
+}
+
+static void
+on_le_event(const uint8_t *packet)
+{
+	int slot;
+
+	switch (hci_event_le_meta_get_subevent_code(packet)) {
+	case HCI_SUBEVENT_LE_CONNECTION_UPDATE_COMPLETE:
+		slot = find_link(hci_subevent_le_connection_update_complete_get_connection_handle(packet));
+		if (slot < 0)
+			break;
+		if (hci_subevent_le_connection_update_complete_get_status(packet) != 0) {
+			// rejected, offer a wider range
+			Link *l = &links[slot];
+			if (l->ble_interval_max < LINK_BLE_INTERVAL_CEILING) {
+				l->ble_interval_max *= 2;
+				if (l->ble_interval_max > LINK_BLE_INTERVAL_CEILING)
+					l->ble_interval_max = LINK_BLE_INTERVAL_CEILING;
+				l->want_update = true;
+			}
+			STAT_INC(STAT_LINK(slot, LINK_STAT_PARAM_REJECTS));
+			DLOG("link %d: interval update rejected, max now %u", slot, l->ble_interval_max);
+			break;
+		}
+		set_ble_interval(slot,
+		                 hci_subevent_le_connection_update_complete_get_conn_interval(packet),
+		                 hci_subevent_le_connection_update_complete_get_conn_latency(packet));
+		DLOG("link %d: interval %u x1.25ms, latency %u", slot,
+		     hci_subevent_le_connection_update_complete_get_conn_interval(packet),
+		     hci_subevent_le_connection_update_complete_get_conn_latency(packet));
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void
+hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size)
+{
+	ARG_UNUSED(channel);
+	ARG_UNUSED(size);
+
+	if (packet_type != HCI_EVENT_PACKET)
+		return;
+
+	int slot;
+
+	switch (hci_event_packet_get_type(packet)) {
+	case HCI_EVENT_LE_META:
+		on_le_event(packet);
+		break;
+
+	case HCI_EVENT_MODE_CHANGE:
+		slot = find_link(hci_event_mode_change_get_handle(packet));
+		if (slot < 0)
+			break;
+		// mode 2 is sniff, its interval is in 0.625 ms slots
+		if (hci_event_mode_change_get_mode(packet) == 2) {
+			LINK_SET(slot, LINK_STAT_INTERVAL_US,
+			         hci_event_mode_change_get_interval(packet) * 625u);
+			STAT_INC(STAT_LINK(slot, LINK_STAT_SNIFF_ENTRIES));
+			DLOG("link %d: sniff, interval %u slots", slot,
+			     hci_event_mode_change_get_interval(packet));
+			links[slot].want_unsniff = LINK_AVOID_SNIFF;
+		} else {
+			LINK_SET(slot, LINK_STAT_INTERVAL_US, 0);
+		}
+		break;
+
+	case GAP_EVENT_RSSI_MEASUREMENT:
+		slot = find_link(gap_event_rssi_measurement_get_con_handle(packet));
+		if (slot >= 0)
+			LINK_SET(slot, LINK_STAT_RSSI,
+			         (uint32_t) (int32_t) gap_event_rssi_measurement_get_rssi(packet));
+		break;
+
+	case HCI_EVENT_DISCONNECTION_COMPLETE:
+		// keep the last numbers readable until the slot is reused
+		slot = find_link(hci_event_disconnection_complete_get_connection_handle(packet));
+		if (slot >= 0) {
+			links[slot].used = false;
+			LINK_SET(slot, LINK_STAT_PROTOCOL, 0);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Issues at most one HCI command per link and tick, the controller has a
+// small command window and Bluepad32 shares it.
+static void
+service_link(int slot)
+{
+	Link *l = &links[slot];
+
+	if (!hci_can_send_command_packet_now())
+		return;
+
+	if (l->want_policy) {
+		// role switch only, sniff and hold stay off
+		if (hci_send_cmd(&hci_write_link_policy_settings, l->handle,
+		                 LM_LINK_POLICY_ENABLE_ROLE_SWITCH) == 0)
+			l->want_policy = false;
+	} else if (l->want_unsniff) {
+		if (hci_send_cmd(&hci_exit_sniff_mode, l->handle) == 0)
+			l->want_unsniff = false;
+	} else if (l->want_update) {
+		if (gap_update_connection_parameters(l->handle, LINK_BLE_INTERVAL_MIN,
+		                                     l->ble_interval_max, 0,
+		                                     LINK_BLE_SUPERVISION_TIMEOUT) == 0)
+			l->want_update = false;
+	}
+}
+
+static void
+poll_timer_cb(btstack_timer_source_t *ts)
+{
+	for (int i = 0; i < LINK_STAT_SLOTS; i++)
+		if (links[i].used)
+			service_link(i);
+
+	// one RSSI read in flight at a time, round robin over the links
+	for (int n = 0; n < LINK_STAT_SLOTS; n++) {
+		int i = (rssi_next + n) % LINK_STAT_SLOTS;
+		if (links[i].used) {
+			if (gap_read_rssi(links[i].handle) == 0)
+				rssi_next = i + 1;
+			break;
+		}
+	}
+
+	btstack_run_loop_set_timer(ts, LINK_POLL_INTERVAL_MS);
+	btstack_run_loop_add_timer(ts);
+}
+
+void
+link_start(void)
+{
+	hci_event_cb.callback = hci_event_handler;
+	hci_add_event_handler(&hci_event_cb);
+
+	btstack_run_loop_set_timer_handler(&poll_timer, poll_timer_cb);
+	btstack_run_loop_set_timer(&poll_timer, LINK_POLL_INTERVAL_MS);
+	btstack_run_loop_add_timer(&poll_timer);
+}
+
+void
+link_on_device_connected(uni_hid_device_t *d)
+{
+	int slot = find_link(d->conn.handle);
+	if (slot < 0) {
+		for (slot = 0; slot < LINK_STAT_SLOTS && links[slot].used; slot++)
+			;
+		if (slot == LINK_STAT_SLOTS)
+			return;
+	}
+
+	Link *l = &links[slot];
+	memset(l, 0, sizeof(*l));
+	l->used = true;
+	l->handle = d->conn.handle;
+	l->protocol = d->conn.protocol;
+
+	clear_link_stats(slot);
+	const uint8_t *a = d->conn.btaddr;
+	// low four address bytes, enough to tell the devices apart
+	LINK_SET(slot, LINK_STAT_ADDR,
+	         ((uint32_t) a[2] << 24) | (a[3] << 16) | (a[4] << 8) | a[5]);
+	LINK_SET(slot, LINK_STAT_PROTOCOL, l->protocol);
+	DLOG("link %d: handle 0x%04x, protocol %d", slot, l->handle, l->protocol);
+
+	if (l->protocol == UNI_BT_CONN_PROTOCOL_BLE) {
+		// what the device connected with, until our update completes
+		set_ble_interval(slot, gap_le_connection_interval(l->handle), 0);
+		l->ble_interval_max = LINK_BLE_INTERVAL_MIN;
+		l->want_update = true;
+	} else {
+		l->want_policy = LINK_AVOID_SNIFF;
+	}
+}
+
+void
+link_on_report(uni_hid_device_t *d)
+{
+	int slot = find_link(d->conn.handle);
+	if (slot < 0)
+		return;
+
+	Link *l = &links[slot];
+	uint32_t now = time_us_32();
+	STAT_INC(STAT_LINK(slot, LINK_STAT_REPORTS));
+
+	uint32_t gap = now - l->last_report_us;
+	bool streaming = l->last_report_us != 0 && gap < LINK_IDLE_GAP_US;
+	l->last_report_us = now;
+	if (!streaming) {
+		l->last_interval_us = 0;
+		return;
+	}
+
+	if (l->avg_interval_us == 0)
+		l->avg_interval_us = gap;
+	else
+		l->avg_interval_us += ((int32_t) gap - (int32_t) l->avg_interval_us) / 16;
+	LINK_SET(slot, LINK_STAT_REPORT_INTERVAL_US, l->avg_interval_us);
+	STAT_MAX(STAT_LINK(slot, LINK_STAT_MAX_GAP_US), gap);
+
+	if (l->last_interval_us) {
+		int32_t delta = (int32_t) gap - (int32_t) l->last_interval_us;
+		if (delta < 0)
+			delta = -delta;
+		// J += (|D| - J) / 16, kept scaled by 16
+		l->jitter_us += delta - ((l->jitter_us + 8) >> 4);
+		LINK_SET(slot, LINK_STAT_JITTER_US, l->jitter_us >> 4);
+
+		if (d->controller.klass == UNI_CONTROLLER_CLASS_MOUSE) {
+			if (admit_scanning()) {
+				mouse_jitter_scan += delta - ((mouse_jitter_scan + 8) >> 4);
+				STAT_SET(STAT_MOUSE_JITTER_SCAN_US, mouse_jitter_scan >> 4);
+			} else {
+				mouse_jitter_idle += delta - ((mouse_jitter_idle + 8) >> 4);
+				STAT_SET(STAT_MOUSE_JITTER_IDLE_US, mouse_jitter_idle >> 4);
+			}
+		}
+	}
+	l->last_interval_us = gap;
+}
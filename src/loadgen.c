@@ -0,0 +1,121 @@
+#include "loadgen.h"
+
+#if ADAPTER_LOADGEN
+
+#include <string.h>
+
+#include <pico/cyw43_arch.h>
+#include <pico/multicore.h>
+#include <pico/time.h>
+#include <uni.h>
+
+#include "sdkconfig.h"
+#include "cycles.h"
+#include "stats.h"
+#include "recovery.h"
+#include "KeyboardKeys.h"
+
+struct uni_platform *get_my_platform(void);
+
+// Next event of a device, every one changes the mapped state so the
+// publish deduplication never hides it. Keyboards alternate button keys:
+// WASD only feed move.c and leave the published report as it was.
+static void
+next_event(uni_hid_device_t *d, uint32_t n)
+{
+	uni_controller_t *ctl = &d->controller;
+
+	if (ctl->klass == UNI_CONTROLLER_CLASS_MOUSE) {
+		memset(&ctl->mouse, 0, sizeof(ctl->mouse));
+		ctl->mouse.delta_x = (n & 1) ? 8 : -8;
+		ctl->mouse.delta_y = (n & 2) ? 4 : -4;
+		ctl->mouse.buttons = (n & 4) ? MOUSE_BUTTON_LEFT : 0;
+	} else {
+		memset(&ctl->keyboard, 0, sizeof(ctl->keyboard));
+		ctl->keyboard.pressed_keys[0] = (n & 1) ? KEY_E : KEY_Q; // Y, A
+		if (n & 2)
+			ctl->keyboard.pressed_keys[1] = KEY_SPACE;
+	}
+}
+
+void
+loadgen_core_task(void)
+{
+	cycles_init();
+
+	// the report exchange locks the cyw43 async context
+	if (cyw43_arch_init())
+		return;
+
+	struct uni_platform *platform = get_my_platform();
+	platform->init(0, NULL);
+
+	// Bluepad32's own device table, so the index lookups work unchanged
+	uni_hid_device_t *devices[LOADGEN_DEVICES];
+	for (int i = 0; i < LOADGEN_DEVICES; i++) {
+		uni_hid_device_t *d = uni_hid_device_get_instance_for_idx(i);
+		d->controller.klass = (i & 1) ? UNI_CONTROLLER_CLASS_KEYBOARD : UNI_CONTROLLER_CLASS_MOUSE;
+		d->conn.btaddr[5] = i; // distinct, bindings are saved by address
+		platform->on_device_ready(d);
+		devices[i] = d;
+	}
+
+	multicore_fifo_push_blocking(0);
+
+	uint32_t rate = LOADGEN_START_RATE;
+	uint32_t best = 0;
+	bool saturated = false;
+	uint32_t n = 0;
+
+	while (1) {
+		STAT_SET(STAT_LOADGEN_RATE, rate);
+		uint32_t period_us = 1000000 / rate;
+		uint32_t step_start = time_us_32();
+		uint32_t next = step_start;
+		uint32_t generated = adapter_stats[STAT_LOADGEN_EVENTS];
+		uint32_t overwritten = adapter_stats[STAT_PUBLISH_OVERWRITTEN];
+		uint32_t cycles = 0;
+		uint32_t events = 0;
+
+		while (time_us_32() - step_start < LOADGEN_STEP_MS * 1000) {
+			while ((int32_t) (time_us_32() - next) < 0)
+				;
+			next += period_us;
+
+			recovery_core1_beat();
+			uni_hid_device_t *d = devices[n % LOADGEN_DEVICES];
+			next_event(d, n / LOADGEN_DEVICES);
+			n++;
+
+			uint32_t start = cycles_now();
+			platform->on_controller_data(d, &d->controller);
+			cycles += cycles_since(start);
+			events++;
+			STAT_INC(STAT_LOADGEN_EVENTS);
+		}
+
+		STAT_SET(STAT_LOADGEN_MAP_CYCLES, cycles / events);
+		uint32_t achieved = events * 1000 / LOADGEN_STEP_MS;
+		STAT_SET(STAT_LOADGEN_ACHIEVED_RATE, achieved);
+
+		// judge the step, then keep ramping until the first dirty one
+		// and stay at the best clean rate from there on
+		generated = adapter_stats[STAT_LOADGEN_EVENTS] - generated;
+		overwritten = adapter_stats[STAT_PUBLISH_OVERWRITTEN] - overwritten;
+		// core1 falling behind its own schedule is saturation as well
+		bool clean = overwritten * LOADGEN_OVERWRITE_TOLERANCE < generated &&
+		             achieved * 20 >= rate * 19;
+		if (saturated)
+			continue;
+		if (clean) {
+			best = rate;
+			STAT_SET(STAT_LOADGEN_MAX_RATE, best);
+			rate += LOADGEN_RATE_STEP;
+		} else {
+			saturated = true;
+			rate = best ? best : LOADGEN_START_RATE;
+		}
+	}
+}
+
+#endif
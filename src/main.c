@@ -7,6 +7,12 @@
 
 #include "sdkconfig.h"
 #include "usb.h"
+#include "profile.h"
+#include "cycles.h"
+#include "memstats.h"
+#include "loadgen.h"
+#include "recovery.h"
+#include "stats.h"
 
 // Sanity check
 #ifndef CONFIG_BLUEPAD32_PLATFORM_CUSTOM
@@ -18,11 +24,16 @@ struct uni_platform *get_my_platform(void);
 
 void bluepad_core_task()
 {
+	cycles_init();
+
 	// initialize CYW43 driver architecture (will enable BT if/because CYW43_ENABLE_BLUETOOTH == 1)
+	// the firmware upload to the radio makes this the longest step of boot
+	uint32_t start_ms = time_us_32() / 1000;
 	if (cyw43_arch_init()) {
 		loge("failed to initialise cyw43_arch\n");
 		return -1;
 	}
+	STAT_SET(STAT_BOOT_CYW43_INIT_MS, time_us_32() / 1000 - start_ms);
 
 	// Turn-on LED. Turn it off once init is done.
 	cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
@@ -40,9 +51,17 @@ void bluepad_core_task()
 int
 main()
 {
+	memstats_paint_stacks();
 	stdio_init_all();
+	profile_init();
+	cycles_init();
+	recovery_init();
 
+#if ADAPTER_LOADGEN
+	multicore_launch_core1(loadgen_core_task);
+#else
 	multicore_launch_core1(bluepad_core_task);
+#endif
 	usb_core_task();
 
 	return 0;
@@ -0,0 +1,123 @@
+#include "memstats.h"
+
+#include <malloc.h>
+#include <stdint.h>
+
+#include <hardware/structs/xip_ctrl.h>
+#include <btstack.h>
+#include <uni.h>
+
+#include "sdkconfig.h"
+#include "stats.h"
+
+#define STACK_PAINT 0xDEADBEEF
+
+// Pico SDK linker script symbols
+extern uint32_t __StackBottom, __StackTop;
+extern uint32_t __StackOneBottom, __StackOneTop;
+
+static btstack_packet_callback_registration_t hci_event_cb;
+static btstack_timer_source_t sample_timer;
+static uint32_t hci_connections;
+
+static void
+paint(uint32_t *from, uint32_t *to)
+{
+	while (from < to)
+		*from++ = STACK_PAINT;
+}
+
+// Bytes used from the top down to the deepest overwritten word
+static uint32_t
+stack_used(uint32_t *bottom, uint32_t *top)
+{
+	uint32_t *p = bottom;
+	while (p < top && *p == STACK_PAINT)
+		p++;
+	return (top - p) * sizeof(uint32_t);
+}
+
+void
+memstats_paint_stacks(void)
+{
+	// core0 is running on its stack, stay clear of the live frames
+	uint32_t *sp = (uint32_t *) __builtin_frame_address(0) - 16;
+	paint(&__StackBottom, sp);
+	paint(&__StackOneBottom, &__StackOneTop);
+
+	STAT_SET(STAT_STACK0_SIZE, (&__StackTop - &__StackBottom) * sizeof(uint32_t));
+	STAT_SET(STAT_STACK1_SIZE, (&__StackOneTop - &__StackOneBottom) * sizeof(uint32_t));
+}
+
+static void
+hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size)
+{
+	ARG_UNUSED(channel);
+	ARG_UNUSED(size);
+
+	if (packet_type != HCI_EVENT_PACKET)
+		return;
+
+	switch (hci_event_packet_get_type(packet)) {
+	case HCI_EVENT_CONNECTION_COMPLETE:
+		if (hci_event_connection_complete_get_status(packet) == 0)
+			hci_connections++;
+		break;
+	case HCI_EVENT_LE_META:
+		if (hci_event_le_meta_get_subevent_code(packet) == HCI_SUBEVENT_LE_CONNECTION_COMPLETE &&
+		    hci_subevent_le_connection_complete_get_status(packet) == 0)
+			hci_connections++;
+		break;
+	case HCI_EVENT_DISCONNECTION_COMPLETE:
+		if (hci_event_disconnection_complete_get_status(packet) == 0 && hci_connections)
+			hci_connections--;
+		break;
+	default:
+		return;
+	}
+
+	STAT_MAX(STAT_HCI_CONNECTIONS_PEAK, hci_connections);
+}
+
+static void
+sample_timer_cb(btstack_timer_source_t *ts)
+{
+	STAT_MAX(STAT_STACK0_PEAK, stack_used(&__StackBottom, &__StackTop));
+	STAT_MAX(STAT_STACK1_PEAK, stack_used(&__StackOneBottom, &__StackOneTop));
+
+	// newlib never hands memory back below the arena top, so arena is the
+	// heap footprint; uordblks is what is allocated right now
+	struct mallinfo mi = mallinfo();
+	STAT_SET(STAT_HEAP_ARENA, mi.arena);
+	STAT_MAX(STAT_HEAP_PEAK, mi.uordblks);
+
+	uint32_t devices = 0;
+	for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+		uni_hid_device_t *d = uni_hid_device_get_instance_for_idx(i);
+		if (d && uni_bt_conn_is_connected(&d->conn))
+			devices++;
+	}
+	STAT_MAX(STAT_BT_DEVICES_PEAK, devices);
+
+	// saturating counters, cleared on write
+	uint32_t accesses = xip_ctrl_hw->ctr_acc;
+	uint32_t hits = xip_ctrl_hw->ctr_hit;
+	xip_ctrl_hw->ctr_acc = 0;
+	xip_ctrl_hw->ctr_hit = 0;
+	STAT_SET(STAT_XIP_ACCESSES, accesses);
+	STAT_SET(STAT_XIP_MISSES, accesses > hits ? accesses - hits : 0);
+
+	btstack_run_loop_set_timer(ts, MEMSTATS_SAMPLE_INTERVAL_MS);
+	btstack_run_loop_add_timer(ts);
+}
+
+void
+memstats_start(void)
+{
+	hci_event_cb.callback = hci_event_handler;
+	hci_add_event_handler(&hci_event_cb);
+
+	btstack_run_loop_set_timer_handler(&sample_timer, sample_timer_cb);
+	btstack_run_loop_set_timer(&sample_timer, MEMSTATS_SAMPLE_INTERVAL_MS);
+	btstack_run_loop_add_timer(&sample_timer);
+}
@@ -0,0 +1,203 @@
+#include "move.h"
+
+#include "usb.h"
+#include "slot.h"
+#include "hot.h"
+#include "KeyboardKeys.h"
+
+// Intent bits, per device on core1 and merged per pad for core0
+#define MOVE_UP 0x01
+#define MOVE_DOWN 0x02
+#define MOVE_LEFT 0x04
+#define MOVE_RIGHT 0x08
+#define MOVE_DIRS 0x0F
+#define MOVE_WALK 0x10
+#define MOVE_BITS 5
+
+// Ramp curve: RAMP_STEPS + 1 magnitudes (Q15), smoothstep shaped so the
+// stick leaves and reaches its target gently. Position along it is kept
+// in 1/256 steps.
+#define RAMP_STEPS 64
+#define RAMP_END (RAMP_STEPS << 8)
+#define Q15_ONE 32768
+#define DIAGONAL 23170 // 1/sqrt(2), Q15
+
+// Full stick deflection in 12-bit units, clamped at the top end
+#define MOVE_FULL 2048
+
+#define FRAME_MASK 0x7FF // USB frame numbers are 11 bits
+
+// per frame, rounded up so the ramp takes exactly ms frames
+#define RAMP_STEP(ms) ((ms) ? (RAMP_END + (ms) - 1) / (ms) : RAMP_END)
+
+typedef struct {
+	int32_t pos;    // along the curve, 1/256 steps
+	uint8_t dirs;   // direction being moved in, kept while slowing down
+	uint16_t frame; // last frame evaluated
+} MoveState;
+
+// core1: what each device holds and where it counts
+typedef struct {
+	uint8_t pad;
+	uint8_t bits;
+} DeviceIntent;
+
+static DeviceIntent CORE1_DATA(device_intent)[SLOT_MAX_DEVICES];
+static uint8_t CORE1_DATA(press_count)[USB_HID_GAMEPADS][MOVE_BITS]; // devices holding each bit
+
+// merged per pad, written by core1
+static volatile uint8_t intent[USB_HID_GAMEPADS];
+
+static uint16_t CORE0_DATA(ramp)[RAMP_STEPS + 1];
+static int32_t CORE0_DATA(walk_pos); // where the curve reaches the walk cap
+static MoveState CORE0_DATA(states)[USB_HID_GAMEPADS];
+
+// x and y (Q15, stick down positive) per MOVE_DIRS mask, opposite keys
+// cancel, diagonals on the unit circle
+static const int16_t HOT_DATA(dir_vector)[16][2] = {
+	[MOVE_UP] = {0, -32767},
+	[MOVE_DOWN] = {0, 32767},
+	[MOVE_LEFT] = {-32767, 0},
+	[MOVE_RIGHT] = {32767, 0},
+	[MOVE_UP | MOVE_LEFT] = {-DIAGONAL, -DIAGONAL},
+	[MOVE_UP | MOVE_RIGHT] = {DIAGONAL, -DIAGONAL},
+	[MOVE_DOWN | MOVE_LEFT] = {-DIAGONAL, DIAGONAL},
+	[MOVE_DOWN | MOVE_RIGHT] = {DIAGONAL, DIAGONAL},
+	[MOVE_UP | MOVE_DOWN | MOVE_LEFT] = {-32767, 0},
+	[MOVE_UP | MOVE_DOWN | MOVE_RIGHT] = {32767, 0},
+	[MOVE_LEFT | MOVE_RIGHT | MOVE_UP] = {0, -32767},
+	[MOVE_LEFT | MOVE_RIGHT | MOVE_DOWN] = {0, 32767},
+};
+
+void
+move_init(void)
+{
+	for (int i = 0; i <= RAMP_STEPS; i++) {
+		// 3x^2 - 2x^3, x = i / RAMP_STEPS
+		int64_t x = (int64_t) i * Q15_ONE / RAMP_STEPS;
+		int64_t s = (3 * x * x * Q15_ONE - 2 * x * x * x) / ((int64_t) Q15_ONE * Q15_ONE);
+		ramp[i] = s >= Q15_ONE ? Q15_ONE - 1 : (uint16_t) s;
+	}
+
+	int32_t cap = (int32_t) Q15_ONE * MOVE_WALK_PERCENT / 100;
+	int i = 0;
+	while (i < RAMP_STEPS && ramp[i] < cap)
+		i++;
+	walk_pos = i << 8;
+}
+
+// Moves a device's contribution to a pad from old to new bits, the merged
+// byte is written once so core0 never sees a half applied change
+static void
+apply(uint8_t pad, uint8_t old, uint8_t new)
+{
+	uint8_t merged = intent[pad];
+	uint8_t changed = old ^ new;
+	while (changed) {
+		int bit = __builtin_ctz(changed);
+		changed &= changed - 1;
+		if (new & (1u << bit)) {
+			if (press_count[pad][bit]++ == 0)
+				merged |= 1u << bit;
+		} else {
+			if (--press_count[pad][bit] == 0)
+				merged &= ~(1u << bit);
+		}
+	}
+	intent[pad] = merged;
+}
+
+void
+move_release(uint8_t device)
+{
+	if (device >= SLOT_MAX_DEVICES)
+		return;
+
+	DeviceIntent *d = &device_intent[device];
+	apply(d->pad, d->bits, 0);
+	d->bits = 0;
+}
+
+void
+move_keyboard_event(uint8_t device, uint8_t pad, uint8_t modifiers,
+                    const uint8_t *keys, int count)
+{
+	if (device >= SLOT_MAX_DEVICES)
+		return;
+	DeviceIntent *d = &device_intent[device];
+	if (pad != d->pad || pad >= USB_HID_GAMEPADS) {
+		move_release(device);
+		if (pad >= USB_HID_GAMEPADS)
+			return;
+		d->pad = pad;
+	}
+
+	uint8_t v = 0;
+	for (int i = 0; keys && i < count; i++) {
+		switch (keys[i]) {
+		case KEY_W:
+			v |= MOVE_UP;
+			break;
+		case KEY_S:
+			v |= MOVE_DOWN;
+			break;
+		case KEY_A:
+			v |= MOVE_LEFT;
+			break;
+		case KEY_D:
+			v |= MOVE_RIGHT;
+			break;
+		default:
+			break;
+		}
+	}
+	if (modifiers & MOVE_WALK_MODIFIER)
+		v |= MOVE_WALK;
+	apply(pad, d->bits, v);
+	d->bits = v;
+}
+
+void
+HOT_FN(move_apply)(uint8_t pad, SwitchOutReport *out, uint16_t frame)
+{
+	if (pad >= USB_HID_GAMEPADS)
+		return;
+
+	MoveState *s = &states[pad];
+	uint8_t v = intent[pad];
+	int32_t frames = (frame - s->frame) & FRAME_MASK;
+	s->frame = frame;
+	// a long pause only needs to finish the ramp
+	if (frames > MOVE_ACCEL_MS + MOVE_DECEL_MS)
+		frames = MOVE_ACCEL_MS + MOVE_DECEL_MS + 1;
+
+	int32_t target = 0;
+	if (dir_vector[v & MOVE_DIRS][0] || dir_vector[v & MOVE_DIRS][1]) {
+		s->dirs = v & MOVE_DIRS;
+		target = (v & MOVE_WALK) ? walk_pos : RAMP_END;
+	}
+
+	if (s->pos < target) {
+		s->pos += frames * RAMP_STEP(MOVE_ACCEL_MS);
+		if (s->pos > target)
+			s->pos = target;
+	} else if (s->pos > target) {
+		s->pos -= frames * RAMP_STEP(MOVE_DECEL_MS);
+		if (s->pos < target)
+			s->pos = target;
+	}
+	if (!s->pos)
+		return;
+
+	// magnitude between two curve points, then along the direction
+	int32_t i = s->pos >> 8;
+	int32_t m = ramp[i];
+	if (i < RAMP_STEPS)
+		m += ((ramp[i + 1] - m) * (s->pos & 0xFF)) >> 8;
+	int32_t len = (m * MOVE_FULL + (1 << 14)) >> 15;
+
+	int32_t lx = out->lx + (len * dir_vector[s->dirs][0] >> 15);
+	int32_t ly = out->ly + (len * dir_vector[s->dirs][1] >> 15);
+	out->lx = lx < SWITCH_STICK_MIN ? SWITCH_STICK_MIN : lx > SWITCH_STICK_MAX ? SWITCH_STICK_MAX : lx;
+	out->ly = ly < SWITCH_STICK_MIN ? SWITCH_STICK_MIN : ly > SWITCH_STICK_MAX ? SWITCH_STICK_MAX : ly;
+}
@@ -0,0 +1,285 @@
+#include "osk.h"
+
+#include <string.h>
+
+#include <pico/platform.h>
+
+#define FRAME_MASK 0x7FF // USB frame numbers are 11 bits
+
+#define OSK_COLS 11
+#define OSK_ROWS 4
+#define OSK_NONE 0xFF
+#define OSK_POS(row, col) (((row) << 4) | (col))
+#define OSK_KEY(row, col) (0x80 | OSK_POS(row, col)) // 0 marks no key
+#define OSK_ROW(pos) ((pos) >> 4)
+#define OSK_COL(pos) ((pos) & 0x0F)
+
+#define OSK_QUEUE_SIZE 256 // power of two
+
+// Console keyboard buttons
+#define OSK_BUTTON_PRESS SWITCH_MASK_A
+#define OSK_BUTTON_SHIFT SWITCH_MASK_L3
+#define OSK_BUTTON_SPACE SWITCH_MASK_Y
+#define OSK_BUTTON_BACKSPACE SWITCH_MASK_B
+#define OSK_BUTTON_OK SWITCH_MASK_PLUS
+
+// Step encoding: low nibble hat direction, high nibble button
+#define OSK_STEP_HAT(h) (h)
+#define OSK_STEP_BUTTON(b) (((b) << 4) | SWITCH_HAT_NOTHING)
+
+enum {
+	OSK_BTN_NONE,
+	OSK_BTN_PRESS,
+	OSK_BTN_SHIFT,
+	OSK_BTN_SPACE,
+	OSK_BTN_BACKSPACE,
+	OSK_BTN_OK,
+};
+
+static const uint16_t osk_button_masks[] = {
+	0,
+	OSK_BUTTON_PRESS,
+	OSK_BUTTON_SHIFT,
+	OSK_BUTTON_SPACE,
+	OSK_BUTTON_BACKSPACE,
+	OSK_BUTTON_OK,
+};
+
+// HID usage -> key position on the console QWERTY layout
+//   1 2 3 4 5 6 7 8 9 0 -
+//   q w e r t y u i o p /
+//   a s d f g h j k l : '
+//   z x c v b n m , . ? !
+// Shifted usages that land on a base key (: ? !) are handled below.
+#define OSK_USAGE_MAX 0x39
+static const uint8_t osk_key_pos[OSK_USAGE_MAX] = {
+	[0x04] = OSK_KEY(2, 0), // a
+	[0x05] = OSK_KEY(3, 4), // b
+	[0x06] = OSK_KEY(3, 2), // c
+	[0x07] = OSK_KEY(2, 2), // d
+	[0x08] = OSK_KEY(1, 2), // e
+	[0x09] = OSK_KEY(2, 3), // f
+	[0x0A] = OSK_KEY(2, 4), // g
+	[0x0B] = OSK_KEY(2, 5), // h
+	[0x0C] = OSK_KEY(1, 7), // i
+	[0x0D] = OSK_KEY(2, 6), // j
+	[0x0E] = OSK_KEY(2, 7), // k
+	[0x0F] = OSK_KEY(2, 8), // l
+	[0x10] = OSK_KEY(3, 6), // m
+	[0x11] = OSK_KEY(3, 5), // n
+	[0x12] = OSK_KEY(1, 8), // o
+	[0x13] = OSK_KEY(1, 9), // p
+	[0x14] = OSK_KEY(1, 0), // q
+	[0x15] = OSK_KEY(1, 3), // r
+	[0x16] = OSK_KEY(2, 1), // s
+	[0x17] = OSK_KEY(1, 4), // t
+	[0x18] = OSK_KEY(1, 6), // u
+	[0x19] = OSK_KEY(3, 3), // v
+	[0x1A] = OSK_KEY(1, 1), // w
+	[0x1B] = OSK_KEY(3, 1), // x
+	[0x1C] = OSK_KEY(1, 5), // y
+	[0x1D] = OSK_KEY(3, 0), // z
+	[0x1E] = OSK_KEY(0, 0), // 1
+	[0x1F] = OSK_KEY(0, 1), // 2
+	[0x20] = OSK_KEY(0, 2), // 3
+	[0x21] = OSK_KEY(0, 3), // 4
+	[0x22] = OSK_KEY(0, 4), // 5
+	[0x23] = OSK_KEY(0, 5), // 6
+	[0x24] = OSK_KEY(0, 6), // 7
+	[0x25] = OSK_KEY(0, 7), // 8
+	[0x26] = OSK_KEY(0, 8), // 9
+	[0x27] = OSK_KEY(0, 9), // 0
+	[0x2D] = OSK_KEY(0, 10), // -
+	[0x34] = OSK_KEY(2, 10), // '
+	[0x36] = OSK_KEY(3, 7), // ,
+	[0x37] = OSK_KEY(3, 8), // .
+	[0x38] = OSK_KEY(1, 10), // /
+};
+
+// Shortest horizontal move between two columns, the cursor wraps around
+static const int8_t osk_col_steps[OSK_COLS][OSK_COLS] = {
+	{ 0,  1,  2,  3,  4,  5, -5, -4, -3, -2, -1},
+	{-1,  0,  1,  2,  3,  4,  5, -5, -4, -3, -2},
+	{-2, -1,  0,  1,  2,  3,  4,  5, -5, -4, -3},
+	{-3, -2, -1,  0,  1,  2,  3,  4,  5, -5, -4},
+	{-4, -3, -2, -1,  0,  1,  2,  3,  4,  5, -5},
+	{-5, -4, -3, -2, -1,  0,  1,  2,  3,  4,  5},
+	{ 5, -5, -4, -3, -2, -1,  0,  1,  2,  3,  4},
+	{ 4,  5, -5, -4, -3, -2, -1,  0,  1,  2,  3},
+	{ 3,  4,  5, -5, -4, -3, -2, -1,  0,  1,  2},
+	{ 2,  3,  4,  5, -5, -4, -3, -2, -1,  0,  1},
+	{ 1,  2,  3,  4,  5, -5, -4, -3, -2, -1,  0},
+};
+
+// hat for (dy + 1) * 3 + (dx + 1)
+static const uint8_t osk_hat_for_step[9] = {
+	SWITCH_HAT_UPLEFT,   SWITCH_HAT_UP,      SWITCH_HAT_UPRIGHT,
+	SWITCH_HAT_LEFT,     SWITCH_HAT_NOTHING, SWITCH_HAT_RIGHT,
+	SWITCH_HAT_DOWNLEFT, SWITCH_HAT_DOWN,    SWITCH_HAT_DOWNRIGHT,
+};
+
+// core1 -> core0 step queue, single producer single consumer
+static uint8_t queue[OSK_QUEUE_SIZE];
+static volatile uint32_t queue_head; // written by core1
+static volatile uint32_t queue_tail; // written by core0
+
+// core1 planner state
+static bool active;
+static uint8_t cursor;
+static uint8_t prev_keys[6];
+
+// core0 player state
+static uint8_t playing;
+static int32_t frames_left;
+static uint16_t last_frame;
+static bool pressed;
+
+static void
+push_step(uint8_t step)
+{
+	uint32_t head = queue_head;
+	if (head - queue_tail >= OSK_QUEUE_SIZE)
+		return; // typing faster than the console takes it
+	queue[head % OSK_QUEUE_SIZE] = step;
+	__dmb();
+	queue_head = head + 1;
+}
+
+static int
+sign(int v)
+{
+	return (v > 0) - (v < 0);
+}
+
+static void
+plan_move(uint8_t target)
+{
+	int dx = osk_col_steps[OSK_COL(cursor)][OSK_COL(target)];
+	int dy = OSK_ROW(target) - OSK_ROW(cursor);
+
+	while (dx || dy) {
+		int sx = sign(dx);
+		int sy = sign(dy);
+		if (!OSK_DIAGONALS && sx && sy)
+			sy = 0; // columns first, then rows
+		push_step(OSK_STEP_HAT(osk_hat_for_step[(sy + 1) * 3 + (sx + 1)]));
+		dx -= sx;
+		dy -= sy;
+	}
+	cursor = target;
+}
+
+static void
+type_usage(uint8_t usage, bool shift)
+{
+	switch (usage) {
+	case 0x2C: // space
+		push_step(OSK_STEP_BUTTON(OSK_BTN_SPACE));
+		return;
+	case 0x2A: // backspace
+		push_step(OSK_STEP_BUTTON(OSK_BTN_BACKSPACE));
+		return;
+	case 0x28: // enter
+		push_step(OSK_STEP_BUTTON(OSK_BTN_OK));
+		return;
+	default:
+		break;
+	}
+
+	uint8_t pos = OSK_NONE;
+	bool upper = false;
+	if (shift) {
+		// shifted symbols that sit on the base layer
+		if (usage == 0x33)
+			pos = OSK_POS(2, 9); // :
+		else if (usage == 0x38)
+			pos = OSK_POS(3, 9); // ?
+		else if (usage == 0x1E)
+			pos = OSK_POS(3, 10); // !
+		else if (usage >= 0x04 && usage <= 0x1D)
+			upper = true;
+		else
+			return; // not on the base layer
+	}
+	if (pos == OSK_NONE) {
+		if (usage >= OSK_USAGE_MAX || !osk_key_pos[usage])
+			return;
+		pos = osk_key_pos[usage] & 0x7F;
+	}
+
+	plan_move(pos);
+	if (upper)
+		push_step(OSK_STEP_BUTTON(OSK_BTN_SHIFT));
+	push_step(OSK_STEP_BUTTON(OSK_BTN_PRESS));
+}
+
+static bool
+was_pressed(uint8_t key)
+{
+	for (int i = 0; i < 6; i++) {
+		if (prev_keys[i] == key)
+			return true;
+	}
+	return false;
+}
+
+bool
+osk_keyboard_event(uint8_t modifiers, const uint8_t *keys, int count)
+{
+	// left or right shift
+	bool shift = modifiers & 0x22;
+	uint8_t now[6] = {0};
+	int n = 0;
+
+	for (int i = 0; i < count && n < 6; i++) {
+		uint8_t key = keys[i];
+		if (!key)
+			continue;
+		now[n++] = key;
+		if (was_pressed(key))
+			continue;
+
+		if (key == OSK_TOGGLE_KEY) {
+			// the console keyboard opens with the cursor on "1"
+			active = !active;
+			cursor = OSK_POS(0, 0);
+		} else if (active) {
+			type_usage(key, shift);
+		}
+	}
+	memcpy(prev_keys, now, sizeof(prev_keys));
+	return active;
+}
+
+bool
+osk_next_frame(SwitchOutReport *out, uint16_t frame)
+{
+	frames_left -= (frame - last_frame) & FRAME_MASK;
+	last_frame = frame;
+
+	if (frames_left <= 0) {
+		if (pressed) {
+			pressed = false;
+			frames_left = OSK_RELEASE_FRAMES;
+		} else {
+			uint32_t tail = queue_tail;
+			if (tail == queue_head) {
+				frames_left = 0;
+				return false;
+			}
+			__dmb();
+			playing = queue[tail % OSK_QUEUE_SIZE];
+			queue_tail = tail + 1;
+			pressed = true;
+			frames_left = OSK_PRESS_FRAMES;
+		}
+	}
+
+	out->buttons = pressed ? osk_button_masks[playing >> 4] : 0;
+	out->hat = pressed ? (playing & 0x0F) : SWITCH_HAT_NOTHING;
+	out->lx = SWITCH_STICK_MID;
+	out->ly = SWITCH_STICK_MID;
+	out->rx = SWITCH_STICK_MID;
+	out->ry = SWITCH_STICK_MID;
+	return true;
+}
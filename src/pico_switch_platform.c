@@ -14,82 +14,113 @@
 #include "report.h"
 #include "SwitchDescriptors.h"
 #include "KeyboardKeys.h"
+#include "profile.h"
+#include "osk.h"
+#include "host_output.h"
+#include "boot_parser.h"
+#include "link.h"
+#include "memstats.h"
+#include "dlog.h"
+#include "trace.h"
+#include "slot.h"
+#include "recovery.h"
+#include "hot.h"
+#include "calib.h"
+#include "move.h"
+#include "admit.h"
+#include "playback.h"
+#include "cycles.h"
+#include "gamepad.h"
+#include "stats.h"
+
+#if ADAPTER_FPU
+#include <arm_acle.h>
+#endif
 
 // Sanity check
 #ifndef CONFIG_BLUEPAD32_PLATFORM_CUSTOM
 #error "Pico W must use BLUEPAD32_PLATFORM_CUSTOM"
 #endif
 
-#define AXIS_DEADZONE 0xa
-#define JOYSTICK_CENTER 0x80
-#define MOUSE_SENSITIVITY 5
-#define MOUSE_IDLE_TIMEOUT_MS 40
-static uint32_t last_mouse_move_time_ms = 0;
+#define JOYSTICK_CENTER SWITCH_STICK_MID
+#define MOUSE_SENSITIVITY 80 // 12-bit stick units per mouse count
+#define MOUSE_INTERVAL_GAP_MS 40 // longer report gaps are pauses, not the mouse's rate
+#define MOUSE_DEFAULT_INTERVAL_US 8000 // 125 Hz until measured
+
+// Slot a device plays in, see slot.h for how they are merged. Normally
+// all of them share the first pad; ADAPTER_SLOT_PER_DEVICE gives each
+// device its own (the load generator spreads over all pads that way).
+#if ADAPTER_SLOT_PER_DEVICE
+#define DEVICE_SLOT(device) ((device) % USB_HID_GAMEPADS)
+#else
+#define DEVICE_SLOT(device) 0
+#endif
 
 // Declarations
-static void trigger_event_on_gamepad(uni_hid_device_t *d);
-SwitchOutReport report[CONFIG_BLUEPAD32_MAX_DEVICES];
-SwitchIdxOutReport idx_r;
+SwitchIdxOutReport CORE1_DATA(idx_r);
 uint8_t connected_controllers;
+static void play_input(const PlaybackRecord* rec);
 
+// Per Bluepad32 device index
 typedef struct {
-    bool has_keyboard;
-    bool has_mouse;
-    uni_keyboard_t keyboard;
-    uni_mouse_t mouse;
-} CombinedControllerState;
-
-static CombinedControllerState combined_states[CONFIG_BLUEPAD32_MAX_DEVICES];
+    uni_hid_device_t *dev;
+    uni_controller_class_t klass;
+    bool mouse_left_stick; // a second mouse in the slot moves instead of aiming
+    uint32_t last_report_us;
+    uint32_t mouse_interval_us; // smoothed while moving, turns counts into a speed
+} DeviceState;
+
+// Bluepad32's devices, then the virtual ones of playback
+#define PLAYBACK_DEVICE_FIRST CONFIG_BLUEPAD32_MAX_DEVICES
+static DeviceState CORE1_DATA(devices)[CONFIG_BLUEPAD32_MAX_DEVICES + PLAYBACK_DEVICES];
+
+// smoothed cycles from mapping to publish, x16
+static uint32_t CORE1_DATA(map_cycles16);
+
+// Gyro aiming needs the IMU of the Pro Controller personality
+static bool aim_uses_gyro(void)
+{
+#if SWITCH_PERSONALITY_PROCON
+	return profile_get()->aim_mode == AIM_MODE_GYRO;
+#else
+	return false;
+#endif
+}
 
 // Helper functions
 static void
-empty_gamepad_report(SwitchOutReport *gamepad)
+HOT_FN(empty_gamepad_report)(SwitchOutReport *gamepad)
 {
 	gamepad->buttons = 0;
 	gamepad->hat = SWITCH_HAT_NOTHING;
-	gamepad->lx = SWITCH_JOYSTICK_MID;
-	gamepad->ly = SWITCH_JOYSTICK_MID;
-	gamepad->rx = SWITCH_JOYSTICK_MID;
-	gamepad->ry = SWITCH_JOYSTICK_MID;
-}
-
-uint8_t
-convert_to_switch_axis(int32_t bluepadAxis)
-{
-	// bluepad32 reports from -512 to 511 as int32_t
-	// switch reports from 0 to 255 as uint8_t
-
-	bluepadAxis += 513;  // now max possible is 1024
-	bluepadAxis /= 4;    // now max possible is 255
-
-	if (bluepadAxis < SWITCH_JOYSTICK_MIN)
-		bluepadAxis = 0;
-	else if ((bluepadAxis > (SWITCH_JOYSTICK_MID - AXIS_DEADZONE)) &&
-	         (bluepadAxis < (SWITCH_JOYSTICK_MID + AXIS_DEADZONE))) {
-		bluepadAxis = SWITCH_JOYSTICK_MID;
-	} else if (bluepadAxis > SWITCH_JOYSTICK_MAX)
-		bluepadAxis = SWITCH_JOYSTICK_MAX;
-
-	return (uint8_t) bluepadAxis;
+	gamepad->lx = SWITCH_STICK_MID;
+	gamepad->ly = SWITCH_STICK_MID;
+	gamepad->rx = SWITCH_STICK_MID;
+	gamepad->ry = SWITCH_STICK_MID;
 }
 
-// Clamp between 0 and 255
-static uint8_t clamp_stick_value(int val) 
+// Clamp to the 12-bit stick range
+static uint16_t HOT_FN(clamp_stick_value)(int val) 
 {
-    if (val < 0) return 0;
-    if (val > 255) return 255;
-    return (uint8_t)val;
+#if ADAPTER_FPU
+    // one USAT on the M33, the stick range is 0..2^12 - 1
+    return (uint16_t)__usat(val, 12);
+#else
+    if (val < SWITCH_STICK_MIN) return SWITCH_STICK_MIN;
+    if (val > SWITCH_STICK_MAX) return SWITCH_STICK_MAX;
+    return (uint16_t)val;
+#endif
 }
 
-static void fill_gamepad_report_from_keyboard(int idx, const uni_keyboard_t* gp) 
+static void HOT_FN(fill_gamepad_report_from_keyboard)(SwitchOutReport* out, const uni_keyboard_t* gp) 
 {
     
 	if ((gp->modifiers & UNI_KEYBOARD_MODIFIER_LEFT_SHIFT)) {
-        report[idx].buttons |= SWITCH_MASK_L3;
+        out->buttons |= SWITCH_MASK_L3;
     }
 
 	if ((gp->modifiers & UNI_KEYBOARD_MODIFIER_LEFT_CONTROL)) {
-        report[idx].buttons |= SWITCH_MASK_R3;
+        out->buttons |= SWITCH_MASK_R3;
     }
 
     for (int i = 0; i < UNI_KEYBOARD_PRESSED_KEYS_MAX; i++) {
@@ -98,75 +129,60 @@ static void fill_gamepad_report_from_keyboard(int idx, const uni_keyboard_t* gp)
 
 			// A Button
             case KEY_Q:
-                report[idx].buttons |= SWITCH_MASK_A;
+                out->buttons |= SWITCH_MASK_A;
                 break;
 
 			// B Button
 			case KEY_SPACE:
-                report[idx].buttons |= SWITCH_MASK_B;
+                out->buttons |= SWITCH_MASK_B;
                 break;
 
 			// X Button
             case KEY_R:
-                report[idx].buttons |= SWITCH_MASK_X;
+                out->buttons |= SWITCH_MASK_X;
                 break;
 
 			// Y Button
 			case KEY_E:
-				report[idx].buttons |= SWITCH_MASK_Y;
+				out->buttons |= SWITCH_MASK_Y;
                 break;
 			
 			// Dpad Down
             case KEY_B:
-                report[idx].hat = SWITCH_HAT_DOWN;
+                out->hat = SWITCH_HAT_DOWN;
                 break;
 
 			//Dpad Up
 			case KEY_F:
-                report[idx].hat = SWITCH_HAT_UP;
+                out->hat = SWITCH_HAT_UP;
                 break;
 			
 			//Dpad Right
 			case KEY_I:
-                report[idx].hat = SWITCH_HAT_RIGHT;
+                out->hat = SWITCH_HAT_RIGHT;
                 break;
 
 			//Minus Button
 			case KEY_TAB:
-                report[idx].buttons |= SWITCH_MASK_MINUS;
+                out->buttons |= SWITCH_MASK_MINUS;
                 break;
 			
 			//Plus Button
 			case KEY_ESC:
-                report[idx].buttons |= SWITCH_MASK_PLUS;
+                out->buttons |= SWITCH_MASK_PLUS;
                 break;
 			
 			//Home Button
 			case KEY_H:
-                report[idx].buttons |= SWITCH_MASK_HOME;
+                out->buttons |= SWITCH_MASK_HOME;
                 break;
 			
 			//Capture Button
 			case KEY_C:
-                report[idx].buttons |= SWITCH_MASK_CAPTURE;
-                break;
-
-			//Left Joystick movement
-            case KEY_W:
-                report[idx].ly = 0x00; // up
+                out->buttons |= SWITCH_MASK_CAPTURE;
                 break;
 
-            case KEY_S:
-                report[idx].ly = 0xFF; // down
-                break;
-
-            case KEY_A:
-                report[idx].lx = 0x00; // left
-                break;
-
-            case KEY_D:
-                report[idx].lx = 0xFF; // right
-                break;
+			// Left Joystick movement (WASD) is ramped on core0, see move.h
 
             default:
                 break;
@@ -174,261 +190,111 @@ static void fill_gamepad_report_from_keyboard(int idx, const uni_keyboard_t* gp)
     }
 }
 
-static void fill_gamepad_report_from_mouse(int idx, const uni_mouse_t* mouse) 
-{   
-	absolute_time_t now = get_absolute_time();
-    uint32_t now_ms = to_ms_since_boot(now);
+// Aiming mouse counts to a right stick offset. Uncalibrated it is a
+// fixed scale. With the game's turn curve (calib.h) the counts become a
+// turn rate at the mouse's report interval, and the curve gives the
+// deflection the game turns at that rate. Both axes use the curve
+// measured on X.
+static int32_t HOT_FN(mouse_to_right_stick)(int32_t delta, uint32_t interval_us)
+{
+	const AdapterProfile *profile = profile_get();
+	if (!profile->turn_curve.max_rate_mdps)
+		return delta * MOUSE_SENSITIVITY;
+
+	return calib_mouse_deflection(&profile->turn_curve, profile->stick_mdeg_per_count,
+	                              delta, interval_us);
+}
 
-	//right click
+static void HOT_FN(fill_gamepad_report_from_mouse)(SwitchOutReport* out, const uni_mouse_t* mouse, bool left_stick, uint32_t interval_us) 
+{
+	//right click, released state comes from the emptied report
+	//so a gamepad trigger in the same slot is not cleared
     if (mouse->buttons & MOUSE_BUTTON_RIGHT) 
 	{
-        report[idx].buttons |= SWITCH_MASK_ZL;
-	} 
-	else 
-	{
-		report[idx].buttons &= ~SWITCH_MASK_ZL; 
-    }
+        out->buttons |= SWITCH_MASK_ZL;
+	}
 
 	//left click
     if (mouse->buttons & MOUSE_BUTTON_LEFT) 
 	{
-        report[idx].buttons |= SWITCH_MASK_ZR;
-    } 
-	else 
-	{
-		report[idx].buttons &= ~SWITCH_MASK_ZR; 
-	}
+        out->buttons |= SWITCH_MASK_ZR;
+    }
 
 	//middle click
 	if (mouse->buttons & MOUSE_BUTTON_MIDDLE) 
 	{
-        report[idx].hat = SWITCH_HAT_LEFT;
+        out->hat = SWITCH_HAT_LEFT;
     }
 
 	//scroll wheel
     if (mouse->scroll_wheel > 0) //up
 	{
-		report[idx].buttons |= SWITCH_MASK_L;
+		out->buttons |= SWITCH_MASK_L;
 		((uni_mouse_t*)mouse)->scroll_wheel = 0;
 	}
 
 	if (mouse->scroll_wheel < 0) //down
 	{
-		report[idx].buttons |= SWITCH_MASK_R;
+		out->buttons |= SWITCH_MASK_R;
 		((uni_mouse_t*)mouse)->scroll_wheel = 0;
 	}
 
-	//mouse movement
-    if (mouse->delta_x != 0 || mouse->delta_y != 0) {
-        last_mouse_move_time_ms = now_ms;
-        int rx = JOYSTICK_CENTER + (mouse->delta_x * MOUSE_SENSITIVITY);
-        int ry = JOYSTICK_CENTER + (mouse->delta_y * MOUSE_SENSITIVITY);
-
-        report[idx].rx = clamp_stick_value(rx);
-        report[idx].ry = clamp_stick_value(ry);
+	//mouse movement, sent as gyro samples instead in gyro mode
+	//(a left stick mouse still moves its stick)
+	if (aim_uses_gyro() && !left_stick)
+		return;
 
-    } 
-	else 
-	{
-        if ((now_ms - last_mouse_move_time_ms) < MOUSE_IDLE_TIMEOUT_MS) {} 
-		else 
-		{
-            report[idx].rx = JOYSTICK_CENTER;
-            report[idx].ry = JOYSTICK_CENTER;
-			
-		}
+    // a mouse at rest leaves its stick centered, other devices of the
+    // slot still move it through the merge
+    if (mouse->delta_x != 0 || mouse->delta_y != 0) {
+        if (left_stick) {
+            out->lx = clamp_stick_value(JOYSTICK_CENTER + mouse->delta_x * MOUSE_SENSITIVITY);
+            out->ly = clamp_stick_value(JOYSTICK_CENTER + mouse->delta_y * MOUSE_SENSITIVITY);
+        } else {
+            out->rx = clamp_stick_value(JOYSTICK_CENTER + mouse_to_right_stick(mouse->delta_x, interval_us));
+            out->ry = clamp_stick_value(JOYSTICK_CENTER + mouse_to_right_stick(mouse->delta_y, interval_us));
+        }
     }
 }
 
-static void
-fill_gamepad_report(int idx, uni_controller_t* ctl)
+#if !ADAPTER_KM_ONLY
+// Bluepad32's bits are the ones gamepad.h maps
+_Static_assert(DPAD_UP == GAMEPAD_DPAD_UP && DPAD_DOWN == GAMEPAD_DPAD_DOWN &&
+               DPAD_RIGHT == GAMEPAD_DPAD_RIGHT && DPAD_LEFT == GAMEPAD_DPAD_LEFT,
+               "dpad bits");
+_Static_assert(BUTTON_A == GAMEPAD_BUTTON_A && BUTTON_B == GAMEPAD_BUTTON_B &&
+               BUTTON_X == GAMEPAD_BUTTON_X && BUTTON_Y == GAMEPAD_BUTTON_Y &&
+               BUTTON_SHOULDER_L == GAMEPAD_BUTTON_SHOULDER_L &&
+               BUTTON_SHOULDER_R == GAMEPAD_BUTTON_SHOULDER_R &&
+               BUTTON_TRIGGER_L == GAMEPAD_BUTTON_TRIGGER_L &&
+               BUTTON_TRIGGER_R == GAMEPAD_BUTTON_TRIGGER_R &&
+               BUTTON_THUMB_L == GAMEPAD_BUTTON_THUMB_L &&
+               BUTTON_THUMB_R == GAMEPAD_BUTTON_THUMB_R,
+               "button bits");
+_Static_assert(MISC_BUTTON_SYSTEM == GAMEPAD_MISC_SYSTEM &&
+               MISC_BUTTON_SELECT == GAMEPAD_MISC_SELECT &&
+               MISC_BUTTON_START == GAMEPAD_MISC_START &&
+               MISC_BUTTON_CAPTURE == GAMEPAD_MISC_CAPTURE,
+               "misc button bits");
+
+// Gamepad fast path: straight into the device's contribution, other
+// devices of the slot are merged with it in slot.c (mixed mode).
+static void HOT_FN(fill_gamepad_report_from_gamepad)(SwitchOutReport* out, const uni_gamepad_t* gp)
 {
-	empty_gamepad_report(&report[idx]);
-
-	//Keyboard logic
-	if (ctl->klass == UNI_CONTROLLER_CLASS_KEYBOARD) {
-
-        uni_keyboard_t* gp = &ctl->keyboard;
-		// face buttons
-		if ((gp->modifiers & UNI_KEYBOARD_MODIFIER_LEFT_SHIFT)) {
-
-			report[idx].buttons |= SWITCH_MASK_L3;
-		}
-
-		for (int i = 0; i < UNI_KEYBOARD_PRESSED_KEYS_MAX; i++) {
-
-			if (gp->pressed_keys[i] == KEY_E) {
-				report[idx].buttons |= SWITCH_MASK_Y;
-				break;
-			}
-
-			if (gp->pressed_keys[i] == KEY_R) {
-				report[idx].buttons |= SWITCH_MASK_Y;
-				break;
-			}
-
-			if (gp->pressed_keys[i] == KEY_SPACE) {
-				report[idx].buttons |= SWITCH_MASK_B;
-				break;
-			}
-
-			if (gp->pressed_keys[i] == KEY_B) {
-				report[idx].hat = SWITCH_HAT_DOWN;
-				break;
-			}
-
-			if (gp->pressed_keys[i] == KEY_Q) {
-				report[idx].buttons |= SWITCH_MASK_A;
-				break;
-			}
-
-			switch (gp->pressed_keys[i]) 
-			{
-				case KEY_W: report[idx].ly = 0x00; break;  // up
-				case KEY_S: report[idx].ly = 0xFF; break;  // down
-				case KEY_A: report[idx].lx = 0x00; break;  // left
-				case KEY_D: report[idx].lx = 0xFF; break;  // right
-			}
-
-
-		}
-	}
-
-	//Mouse logic
-    if (ctl->klass == UNI_CONTROLLER_CLASS_MOUSE) {
-
-        uni_mouse_t* mouse = &ctl->mouse;
-		absolute_time_t now = get_absolute_time();
-		uint32_t now_ms = to_ms_since_boot(now);
-
-        if (mouse->buttons & MOUSE_BUTTON_RIGHT)
-		{
-			report[idx].buttons |= SWITCH_MASK_ZL;
-		}
-
-		if (mouse->buttons & MOUSE_BUTTON_LEFT)
-		{
-			report[idx].buttons |= SWITCH_MASK_ZR;
-		}
-
-		if (mouse->scroll_wheel > 0)
-		{
-			report[idx].buttons |= SWITCH_MASK_R;
-		}
-        
-		if (mouse->scroll_wheel < 0)
-		{
-			report[idx].buttons |= SWITCH_MASK_L;
-		}
-		
-		/*
-		int rx = JOYSTICK_CENTER + (mouse->delta_x * MOUSE_SENSITIVITY);
-		int ry = JOYSTICK_CENTER + (mouse->delta_y * MOUSE_SENSITIVITY);
-
-		report[idx].rx = clamp_stick_value(rx);
-		report[idx].ry = clamp_stick_value(ry);
-		*/
-		
-		if (mouse->delta_x != 0 || mouse->delta_y != 0) {
-			last_mouse_move_time_ms = now_ms;
-
-			int rx = JOYSTICK_CENTER + (mouse->delta_x * MOUSE_SENSITIVITY);
-			int ry = JOYSTICK_CENTER + (mouse->delta_y * MOUSE_SENSITIVITY);
-
-			report[idx].rx = clamp_stick_value(rx);
-			report[idx].ry = clamp_stick_value(ry);
-		}
-		else {
-			if ((now_ms - last_mouse_move_time_ms) < MOUSE_IDLE_TIMEOUT_MS) {
-				// Keep stick at last value — don’t snap to center yet
-			} else {
-				// Reset stick to center after timeout
-				report[idx].rx = JOYSTICK_CENTER;
-				report[idx].ry = JOYSTICK_CENTER;
-			}
-		}
-            
-    }
-	/*
-	if ((gp->modifiers & KEY_W)) {
-		report[idx].buttons |= SWITCH_MASK_B;
-	}
-	
-	if ((gp->buttons & BUTTON_X)) {
-		report[idx].buttons |= SWITCH_MASK_X;
-	}
-	if ((gp->buttons & BUTTON_Y)) {
-		report[idx].buttons |= SWITCH_MASK_Y;
-	}
-
-	// shoulder buttons
-	if ((gp->buttons & BUTTON_SHOULDER_L)) {
-		report[idx].buttons |= SWITCH_MASK_L;
-	}
-	if ((gp->buttons & BUTTON_SHOULDER_R)) {
-		report[idx].buttons |= SWITCH_MASK_R;
-	}
-
-	// dpad
-	switch (gp->dpad) {
-	case DPAD_UP:
-		report[idx].hat = SWITCH_HAT_UP;
-		break;
-	case DPAD_DOWN:
-		report[idx].hat = SWITCH_HAT_DOWN;
-		break;
-	case DPAD_LEFT:
-		report[idx].hat = SWITCH_HAT_LEFT;
-		break;
-	case DPAD_RIGHT:
-		report[idx].hat = SWITCH_HAT_RIGHT;
-		break;
-	case DPAD_UP | DPAD_RIGHT:
-		report[idx].hat = SWITCH_HAT_UPRIGHT;
-		break;
-	case DPAD_DOWN | DPAD_RIGHT:
-		report[idx].hat = SWITCH_HAT_DOWNRIGHT;
-		break;
-	case DPAD_DOWN | DPAD_LEFT:
-		report[idx].hat = SWITCH_HAT_DOWNLEFT;
-		break;
-	case DPAD_UP | DPAD_LEFT:
-		report[idx].hat = SWITCH_HAT_UPLEFT;
-		break;
-	default:
-		report[idx].hat = SWITCH_HAT_NOTHING;
-		break;
-	}
-	*/
-	/*
-	// sticks
-	report[idx].lx = convert_to_switch_axis(gp->axis_x);
-	report[idx].ly = convert_to_switch_axis(gp->axis_y);
-	report[idx].rx = convert_to_switch_axis(gp->axis_rx);
-	report[idx].ry = convert_to_switch_axis(gp->axis_ry);
-	if ((gp->buttons & BUTTON_THUMB_L))
-		report[idx].buttons |= SWITCH_MASK_L3;
-	if ((gp->buttons & BUTTON_THUMB_R))
-		report[idx].buttons |= SWITCH_MASK_R3;
-
-	
-	// triggers
-	if (gp->brake)
-		report[idx].buttons |= SWITCH_MASK_ZL;
-	if (gp->throttle)
-		report[idx].buttons |= SWITCH_MASK_ZR;
-
-	// misc buttons
-	if (gp->misc_buttons & MISC_BUTTON_SYSTEM)
-		report[idx].buttons |= SWITCH_MASK_HOME;
-	if (gp->misc_buttons & MISC_BUTTON_CAPTURE)
-		report[idx].buttons |= SWITCH_MASK_CAPTURE;
-	if (gp->misc_buttons & MISC_BUTTON_BACK)
-		report[idx].buttons |= SWITCH_MASK_MINUS;
-	if (gp->misc_buttons & MISC_BUTTON_HOME)
-		report[idx].buttons |= SWITCH_MASK_PLUS;
-	*/
+	GamepadState s = {
+		.dpad = gp->dpad,
+		.misc_buttons = gp->misc_buttons,
+		.buttons = gp->buttons,
+		.axis_x = gp->axis_x,
+		.axis_y = gp->axis_y,
+		.axis_rx = gp->axis_rx,
+		.axis_ry = gp->axis_ry,
+		.brake = gp->brake,
+		.throttle = gp->throttle,
+	};
+	gamepad_fill(out, &s);
 }
+#endif
 
 static void
 set_led_status() {
@@ -438,6 +304,21 @@ set_led_status() {
 		cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
 }
 
+// Counted from the bound devices rather than kept by connect and
+// disconnect events: Bluepad32 reports a disconnect for devices that
+// never became ready too.
+static void
+update_connected(void)
+{
+	connected_controllers = 0;
+	for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+		if (devices[i].dev)
+			connected_controllers++;
+	}
+	set_led_status();
+	admit_set_devices(connected_controllers);
+}
+
 //
 // Platform Overrides
 //
@@ -446,7 +327,7 @@ static void pico_switch_platform_init(int argc, const char** argv)
     ARG_UNUSED(argc);
     ARG_UNUSED(argv);
 
-    logi("my_platform: init()\n");
+    DLOG("my_platform: init()");
 
 	connected_controllers = 0;
 
@@ -460,6 +341,11 @@ static void pico_switch_platform_init(int argc, const char** argv)
 
 	uni_gamepad_set_mappings(&mappings);
 
+#if !ADAPTER_KM_ONLY
+	gamepad_init();
+#endif
+	slot_init();
+
 	idx_r.idx = 0;
 	idx_r.report.buttons = 0;
 	idx_r.report.hat = SWITCH_HAT_NOTHING;
@@ -472,15 +358,17 @@ static void pico_switch_platform_init(int argc, const char** argv)
 }
 
 static void pico_switch_platform_on_init_complete(void) {
-    logi("my_platform: on_init_complete()\n");
+    DLOG("my_platform: on_init_complete()");
 
     // Safe to call "unsafe" functions since they are called from BT thread
 
-    // Start scanning
-    uni_bt_enable_new_connections_unsafe(true);
+    // Scanning only while a device slot is free, see admit.h
+    admit_start();
 
     // Based on runtime condition you can delete or list the stored BT keys.
-    if (1)
+    // After a watchdog reset the bonds stay, so the devices that were
+    // playing reconnect on their own without pairing again.
+    if (!recovery_after_watchdog())
         uni_bt_del_keys_unsafe();
     else
         uni_bt_list_keys_unsafe();
@@ -488,75 +376,287 @@ static void pico_switch_platform_on_init_complete(void) {
     // Turn off LED once init is done.
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
 
-	logi("BLUEPAD: ready to fill reports");
+	// console LEDs and rumble to the devices
+	host_output_start();
+
+	// connection interval, sniff and link health
+	link_start();
+
+	memstats_start();
+
+	// heartbeat for the watchdog
+	recovery_start();
+
+	// raw input played back from flash
+	playback_start(play_input);
+
+	STAT_SET(STAT_BOOT_BT_READY_MS, time_us_32() / 1000);
+	DLOG("BLUEPAD: ready to fill reports");
 	multicore_fifo_push_blocking(0); // signal other core to start reading
 }
 
+static void
+HOT_FN(publish_slot)(uint8_t slot)
+{
+	idx_r.idx = slot;
+	idx_r.report = *slot_report(slot);
+	set_global_gamepad_report(&idx_r);
+}
+
+static void
+bind_device(uni_hid_device_t* d, int device)
+{
+	DeviceState *state = &devices[device];
+	state->dev = d;
+	state->klass = d->controller.klass;
+	state->mouse_left_stick = false;
+	state->last_report_us = 0;
+	state->mouse_interval_us = MOUSE_DEFAULT_INTERVAL_US;
+
+	uint8_t slot = DEVICE_SLOT(device);
+	uint8_t flags;
+
+	if (recovery_saved_device(d->conn.btaddr, &slot, &flags)) {
+		// back after a watchdog reset, it keeps its place
+		state->mouse_left_stick = flags & RECOVERY_LEFT_STICK;
+	} else if (state->klass == UNI_CONTROLLER_CLASS_MOUSE) {
+		// the first mouse of a slot aims with the right stick, a second
+		// one takes the left stick
+		for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
+			if (i != device && devices[i].dev && slot_of(i) == slot &&
+			    devices[i].klass == UNI_CONTROLLER_CLASS_MOUSE && !devices[i].mouse_left_stick)
+				state->mouse_left_stick = true;
+		}
+	}
+
+	slot_bind(device, slot);
+	recovery_save_device(d->conn.btaddr, slot,
+	                     state->mouse_left_stick ? RECOVERY_LEFT_STICK : 0);
+}
+
+static uni_error_t pico_switch_platform_on_device_discovered(bd_addr_t addr, const char* name,
+                                                            uint16_t cod, uint8_t rssi) {
+	ARG_UNUSED(addr);
+	ARG_UNUSED(name);
+	ARG_UNUSED(rssi);
+	return admit_device_discovered(cod);
+}
+
 static void pico_switch_platform_on_device_connected(uni_hid_device_t* d) {
-    logi("my_platform: device connected: %p\n", d);
+    DLOG("my_platform: device connected: %p", d);
+	link_on_device_connected(d);
 }
 
 static void pico_switch_platform_on_device_disconnected(uni_hid_device_t* d) {
-    logi("my_platform: device disconnected: %p\n", d);
-	// NOT WORKING?
-	// This is complicated. uni_hid_device_get_idx_for_instance 
-	// no longer gives us the index once the device is disconnected.
-	// We assume in this case that a device disconnecting is in a state of no gameplay
-	// so we set momentarelly all gamepad reports to 0.
-	// If this disconnection happens during gameplay, the gamepad would be stuck in the last state.
+    DLOG("my_platform: device disconnected: %p", d);
+	// uni_hid_device_get_idx_for_instance no longer knows the device here,
+	// so look it up by pointer. Only its contribution leaves the slot, the
+	// other devices keep playing.
 	for (int i = 0; i < CONFIG_BLUEPAD32_MAX_DEVICES; i++) {
-		empty_gamepad_report(&report[i]);
-		idx_r.idx = i;
-		idx_r.report = report[i];
-		set_global_gamepad_report(&idx_r);
+		if (devices[i].dev != d)
+			continue;
+		devices[i].dev = NULL;
+		recovery_forget_device(d->conn.btaddr);
+		// a key held at disconnect must not keep walking
+		move_release(i);
+		uint8_t slot = slot_unbind(i);
+		if (slot != SLOT_NONE)
+			publish_slot(slot);
 	}
-	connected_controllers--;
-	set_led_status();
+	update_connected();
 }
 
 static uni_error_t pico_switch_platform_on_device_ready(uni_hid_device_t* d) {
-    logi("my_platform: device ready: %p\n", d);
+    DLOG("my_platform: device ready: %p", d);
 
-	connected_controllers++;
-	set_led_status();
+	boot_parser_install(d);
+
+	int device = uni_hid_device_get_idx_for_instance(d);
+	if (device >= 0 && device < CONFIG_BLUEPAD32_MAX_DEVICES)
+		bind_device(d, device);
+
+	update_connected();
     return UNI_ERROR_SUCCESS;
 }
 
-static void pico_switch_platform_on_controller_data(uni_hid_device_t* d, uni_controller_t* ctl)
+#if SWITCH_HID_PASSTHROUGH
+// Native mouse and keyboard: raw state, no stick conversion
+static void forward_passthrough(const uni_controller_t* ctl)
 {
-	uint8_t idx = 0;
-    CombinedControllerState* state = &combined_states[idx];
+	if (ctl->klass == UNI_CONTROLLER_CLASS_KEYBOARD)
+	{
+		PassthroughKeyboard kbd = {0};
+		int n = 0;
+
+		kbd.modifiers = ctl->keyboard.modifiers;
+		for (int i = 0; i < UNI_KEYBOARD_PRESSED_KEYS_MAX && n < 6; i++) {
+			if (ctl->keyboard.pressed_keys[i])
+				kbd.keys[n++] = ctl->keyboard.pressed_keys[i];
+		}
+		set_global_keyboard_report(&kbd);
+	}
+	else if (ctl->klass == UNI_CONTROLLER_CLASS_MOUSE)
+	{
+		add_global_mouse_motion(ctl->mouse.delta_x, ctl->mouse.delta_y,
+		                        ctl->mouse.scroll_wheel, ctl->mouse.buttons);
+	}
+}
+#endif
 
-    // Update input state
+// Maps one report of a device into its slot and publishes the slot.
+// start is when the report came in, TRACE_MAP has begun.
+static void HOT_FN(map_report)(int device, uni_controller_t* ctl, uint32_t start)
+{
+	DeviceState* state = &devices[device];
+
+	// this device's share of the slot, merged with the others in slot.c
+	SwitchOutReport contribution;
+	empty_gamepad_report(&contribution);
+
+#if !ADAPTER_KM_ONLY
+    if (ctl->klass == UNI_CONTROLLER_CLASS_GAMEPAD)
+	{
+		fill_gamepad_report_from_gamepad(&contribution, &ctl->gamepad);
+    }
+    else
+#endif
     if (ctl->klass == UNI_CONTROLLER_CLASS_KEYBOARD) 
 	{
-        state->has_keyboard = true;
-        state->keyboard = ctl->keyboard;
+		// while calibrating or typing on the console keyboard, keys do
+		// not reach the pad
+		bool calibrating = calib_keyboard_event(&contribution, ctl->keyboard.pressed_keys,
+		                                        UNI_KEYBOARD_PRESSED_KEYS_MAX,
+		                                        time_us_32() / 1000);
+		STAT_SET(STAT_CALIB_PROBE, calib_probe());
+		STAT_SET(STAT_CALIB_MAX_RATE_MDPS, profile_get()->turn_curve.max_rate_mdps);
+		if (!calibrating &&
+		    !osk_keyboard_event(ctl->keyboard.modifiers, ctl->keyboard.pressed_keys,
+		                        UNI_KEYBOARD_PRESSED_KEYS_MAX)) {
+			fill_gamepad_report_from_keyboard(&contribution, &ctl->keyboard);
+			move_keyboard_event(device, slot_of(device), ctl->keyboard.modifiers,
+			                    ctl->keyboard.pressed_keys, UNI_KEYBOARD_PRESSED_KEYS_MAX);
+		} else {
+			move_release(device);
+		}
     } 
 	else if (ctl->klass == UNI_CONTROLLER_CLASS_MOUSE) 
 	{
-        state->has_mouse = true;
-        state->mouse = ctl->mouse;
+		// every mouse event is new motion, accumulate it for the gyro
+		if (aim_uses_gyro() && !state->mouse_left_stick)
+			add_global_mouse_motion(ctl->mouse.delta_x, ctl->mouse.delta_y,
+			                        0, ctl->mouse.buttons);
+
+		// report interval while the mouse keeps moving, pauses left out
+		uint32_t now_us = time_us_32();
+		uint32_t interval = now_us - state->last_report_us;
+		state->last_report_us = now_us;
+		if (interval < MOUSE_INTERVAL_GAP_MS * 1000)
+			state->mouse_interval_us += ((int32_t) interval - (int32_t) state->mouse_interval_us) / 8;
+
+		fill_gamepad_report_from_mouse(&contribution, &ctl->mouse, state->mouse_left_stick,
+		                               state->mouse_interval_us);
     }
 
-	//empty report
-	empty_gamepad_report(&report[idx]);
+	uint8_t slot = slot_update(device, &contribution);
 
-	//fill report with new mouse and keyboard data
-    if (state->has_keyboard)
-	{
-		fill_gamepad_report_from_keyboard(idx, &state->keyboard);
+    TRACE_END(TRACE_MAP, ctl->klass);
+
+	if (slot != SLOT_NONE)
+		publish_slot(slot);
+
+	uint32_t cycles = cycles_since(start);
+	map_cycles16 += cycles - ((map_cycles16 + 8) >> 4);
+	STAT_SET(STAT_MAP_CYCLES, map_cycles16 >> 4);
+	STAT_MAX(STAT_MAP_CYCLES_MAX, cycles);
+}
+
+
+static void HOT_FN(pico_switch_platform_on_controller_data)(uni_hid_device_t* d, uni_controller_t* ctl)
+{
+	boot_parser_report_done(d);
+	link_on_report(d);
+	recovery_on_report(d->conn.btaddr);
+
+	uint32_t start = cycles_now();
+	TRACE_BEGIN(TRACE_MAP, ctl->klass);
+
+	// chords of the adapter itself, never from played back input
+	if (ctl->klass == UNI_CONTROLLER_CLASS_KEYBOARD) {
+		admit_keyboard_event(ctl->keyboard.modifiers, ctl->keyboard.pressed_keys,
+		                     UNI_KEYBOARD_PRESSED_KEYS_MAX);
+		playback_keyboard_event(ctl->keyboard.modifiers, ctl->keyboard.pressed_keys,
+		                        UNI_KEYBOARD_PRESSED_KEYS_MAX);
 	}
-        
-    if (state->has_mouse)
-	{
-        fill_gamepad_report_from_mouse(idx, &state->mouse);
+
+#if SWITCH_HID_PASSTHROUGH
+	if (profile_get()->passthrough) {
+		forward_passthrough(ctl);
+		TRACE_END(TRACE_MAP, ctl->klass);
+		return;
 	}
+#endif
 
-    idx_r.idx = idx;
-    idx_r.report = report[idx];
-    set_global_gamepad_report(&idx_r);
+	int device = uni_hid_device_get_idx_for_instance(d);
+	if (device < 0 || device >= CONFIG_BLUEPAD32_MAX_DEVICES) {
+		TRACE_END(TRACE_MAP, ctl->klass);
+		return;
+	}
+	if (devices[device].dev != d)
+		bind_device(d, device);
 
+	map_report(device, ctl, start);
+}
+
+// Raw input played back from flash (playback.h), mapped like a Bluetooth
+// report from a virtual device joining the record's pad
+static void
+play_input(const PlaybackRecord* rec)
+{
+	if (rec->kind == PLAYBACK_END) {
+		for (int i = 0; i < PLAYBACK_DEVICES; i++) {
+			int device = PLAYBACK_DEVICE_FIRST + i;
+			// held movement keys must not keep walking after the recording
+			move_release(device);
+			uint8_t slot = slot_unbind(device);
+			if (slot != SLOT_NONE)
+				publish_slot(slot);
+		}
+		return;
+	}
+	if (rec->device >= PLAYBACK_DEVICES || rec->pad >= USB_HID_GAMEPADS)
+		return;
+
+	uni_controller_t ctl;
+	memset(&ctl, 0, sizeof(ctl));
+	if (rec->kind == PLAYBACK_KEYBOARD) {
+		ctl.klass = UNI_CONTROLLER_CLASS_KEYBOARD;
+		ctl.keyboard.modifiers = rec->keyboard.modifiers;
+		memcpy(ctl.keyboard.pressed_keys, rec->keyboard.keys, sizeof(rec->keyboard.keys));
+	} else if (rec->kind == PLAYBACK_MOUSE) {
+		ctl.klass = UNI_CONTROLLER_CLASS_MOUSE;
+		ctl.mouse.delta_x = rec->mouse.dx;
+		ctl.mouse.delta_y = rec->mouse.dy;
+		ctl.mouse.scroll_wheel = rec->mouse.wheel;
+		ctl.mouse.buttons = rec->mouse.buttons;
+	} else {
+		return;
+	}
+
+	int device = PLAYBACK_DEVICE_FIRST + rec->device;
+	DeviceState* state = &devices[device];
+	if (slot_of(device) != rec->pad || state->klass != ctl.klass) {
+		move_release(device);
+		state->dev = NULL;
+		state->klass = ctl.klass;
+		state->mouse_left_stick = false;
+		state->last_report_us = 0;
+		state->mouse_interval_us = MOUSE_DEFAULT_INTERVAL_US;
+		slot_bind(device, rec->pad);
+	}
+
+	uint32_t start = cycles_now();
+	TRACE_BEGIN(TRACE_MAP, ctl.klass);
+	map_report(device, &ctl, start);
 }
 
 static const uni_property_t* pico_switch_platform_get_property(uni_property_idx_t idx) {
@@ -571,29 +671,6 @@ static void pico_switch_platform_on_oob_event(uni_platform_oob_event_t event, vo
 	return;
 }
 
-//
-// Helpers - UNUSED
-//
-static void trigger_event_on_gamepad(uni_hid_device_t* d) {
-    if (d->report_parser.set_player_leds != NULL) {
-        static uint8_t led = 0;
-        led += 1;
-        led &= 0xf;
-        d->report_parser.set_player_leds(d, led);
-    }
-
-    if (d->report_parser.set_lightbar_color != NULL) {
-        static uint8_t red = 0x10;
-        static uint8_t green = 0x20;
-        static uint8_t blue = 0x40;
-
-        red += 0x10;
-        green -= 0x20;
-        blue += 0x40;
-        d->report_parser.set_lightbar_color(d, red, green, blue);
-    }
-}
-
 //
 // Entry Point
 //
@@ -602,6 +679,7 @@ struct uni_platform* get_my_platform(void) {
         .name = "My Platform",
         .init = pico_switch_platform_init,
         .on_init_complete = pico_switch_platform_on_init_complete,
+        .on_device_discovered = pico_switch_platform_on_device_discovered,
         .on_device_connected = pico_switch_platform_on_device_connected,
         .on_device_disconnected = pico_switch_platform_on_device_disconnected,
         .on_device_ready = pico_switch_platform_on_device_ready,
@@ -0,0 +1,205 @@
+#include "playback.h"
+
+#include <string.h>
+
+#include <pico/platform.h>
+#include <pico/cyw43_arch.h>
+#include <pico/async_context.h>
+#include <pico/btstack_flash_bank.h>
+
+#include "usb.h"
+#include "hot.h"
+#include "stats.h"
+
+#define FRAME_MASK 0x7FF // USB frame numbers are 11 bits
+#define NO_PAD 0xFF
+
+#define HEADER ((const PlaybackHeader *) (XIP_BASE + PLAYBACK_FLASH_OFFSET))
+#define RECORDS ((const PlaybackRecord *) (HEADER + 1))
+// the recording ends where BTstack keeps its link keys
+#define MAX_RECORDS                                                                     \
+	((PICO_FLASH_BANK_STORAGE_OFFSET - PLAYBACK_FLASH_OFFSET - sizeof(PlaybackHeader)) / \
+	 sizeof(PlaybackRecord))
+
+// core0 -> core1 raw input, single producer single consumer
+static PlaybackRecord queue[PLAYBACK_QUEUE_SIZE];
+static volatile uint32_t queue_head; // written by core0
+static volatile uint32_t queue_tail; // written by core1
+
+static volatile uint8_t chord_presses; // written by core1
+
+// core1
+static bool chord_down;
+static void (*input_cb)(const PlaybackRecord *rec);
+static async_when_pending_worker_t input_worker;
+
+// core0 player, the recording itself stays in flash
+static uint8_t CORE0_DATA(seen_presses);
+static bool CORE0_DATA(playing);
+static uint32_t CORE0_DATA(count);
+static uint32_t CORE0_DATA(next);  // record to release next
+static int32_t CORE0_DATA(wait);   // frames until it is due
+static uint16_t CORE0_DATA(last_frame);
+static uint8_t CORE0_DATA(owned);   // pads the recording plays
+static uint8_t CORE0_DATA(changed); // of those, with a report not sent yet
+static SwitchOutReport CORE0_DATA(pads)[USB_HID_GAMEPADS];
+
+static void
+push_input(const PlaybackRecord *rec)
+{
+	uint32_t head = queue_head;
+	if (head - queue_tail >= PLAYBACK_QUEUE_SIZE) {
+		STAT_INC(STAT_PLAYBACK_DROPPED);
+		return; // core1 busy for longer than the queue lasts
+	}
+	queue[head % PLAYBACK_QUEUE_SIZE] = *rec;
+	__dmb();
+	queue_head = head + 1;
+	async_context_set_work_pending(cyw43_arch_async_context(), &input_worker);
+}
+
+static void
+input_worker_cb(async_context_t *context, async_when_pending_worker_t *worker)
+{
+	(void) context;
+	(void) worker;
+
+	uint32_t tail = queue_tail;
+	while (tail != queue_head) {
+		__dmb();
+		PlaybackRecord rec = queue[tail % PLAYBACK_QUEUE_SIZE];
+		queue_tail = ++tail;
+		input_cb(&rec);
+	}
+}
+
+void
+playback_start(void (*on_input)(const PlaybackRecord *rec))
+{
+	input_cb = on_input;
+	input_worker.do_work = input_worker_cb;
+	async_context_add_when_pending_worker(cyw43_arch_async_context(), &input_worker);
+}
+
+void
+playback_keyboard_event(uint8_t modifiers, const uint8_t *keys, int count)
+{
+	bool down = false;
+	if ((modifiers & PLAYBACK_CHORD_MODIFIERS) == PLAYBACK_CHORD_MODIFIERS) {
+		for (int i = 0; i < count; i++) {
+			if (keys[i] == PLAYBACK_CHORD_KEY)
+				down = true;
+		}
+	}
+	if (down && !chord_down)
+		chord_presses++;
+	chord_down = down;
+}
+
+static void
+start(uint16_t frame)
+{
+	const PlaybackHeader *h = HEADER;
+	if (h->magic != PLAYBACK_MAGIC || h->count == 0) {
+		STAT_SET(STAT_PLAYBACK_STATE, PLAYBACK_STATE_NO_RECORDING);
+		return;
+	}
+
+	count = h->count < MAX_RECORDS ? h->count : MAX_RECORDS;
+	next = 0;
+	wait = RECORDS[0].frames;
+	last_frame = frame;
+	owned = 0;
+	changed = 0;
+	playing = true;
+	STAT_SET(STAT_PLAYBACK_STATE, PLAYBACK_STATE_PLAYING);
+}
+
+static void
+stop(void)
+{
+	playing = false;
+	owned = 0;
+	changed = 0;
+	// the virtual devices leave their pads on core1
+	PlaybackRecord end = {.kind = PLAYBACK_END};
+	push_input(&end);
+	STAT_SET(STAT_PLAYBACK_STATE, PLAYBACK_STATE_IDLE);
+}
+
+static void
+HOT_FN(release)(const PlaybackRecord *rec)
+{
+	STAT_INC(STAT_PLAYBACK_RECORDS);
+
+	if (rec->kind != PLAYBACK_PAD) {
+		push_input(rec);
+		return;
+	}
+	if (rec->pad >= USB_HID_GAMEPADS)
+		return;
+
+	SwitchOutReport *p = &pads[rec->pad];
+	p->buttons = rec->report.buttons;
+	p->hat = rec->report.hat;
+	p->lx = rec->report.lx;
+	p->ly = rec->report.ly;
+	p->rx = rec->report.rx;
+	p->ry = rec->report.ry;
+	owned |= 1u << rec->pad;
+	changed |= 1u << rec->pad;
+}
+
+bool
+HOT_FN(playback_next_frame)(const SwitchIdxOutReport *live, SwitchIdxOutReport *out, uint16_t frame)
+{
+	uint8_t presses = chord_presses;
+	if (presses != seen_presses) {
+		seen_presses = presses;
+		if (playing)
+			stop();
+		else
+			start(frame);
+	}
+	if (!playing)
+		return false;
+
+	// every record due by this frame, several can share one
+	wait -= (frame - last_frame) & FRAME_MASK;
+	last_frame = frame;
+	bool ended = false;
+	while (wait <= 0 && !ended) {
+		PlaybackRecord rec;
+		memcpy(&rec, &RECORDS[next], sizeof(rec));
+		release(&rec);
+		if (++next < count)
+			wait += RECORDS[next].frames;
+		else
+			ended = true;
+	}
+
+	// a pad with a new report goes first, a live report of a pad the
+	// recording owns is replaced by the recording's state
+	uint8_t pad = NO_PAD;
+	if (changed)
+		pad = __builtin_ctz(changed);
+	else if (live->idx < USB_HID_GAMEPADS && (owned & (1u << live->idx)))
+		pad = live->idx;
+	// changed stays set until playback_sent(), a report the endpoint
+	// was not ready for goes out in a later frame
+	if (pad != NO_PAD) {
+		out->idx = pad;
+		out->report = pads[pad];
+	}
+
+	if (ended)
+		stop();
+	return pad != NO_PAD;
+}
+
+void
+HOT_FN(playback_sent)(const SwitchIdxOutReport *out)
+{
+	if (out->idx < USB_HID_GAMEPADS)
+		changed &= ~(1u << out->idx);
+}
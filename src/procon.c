@@ -0,0 +1,426 @@
+#include "procon.h"
+
+#include "hot.h"
+
+#include <string.h>
+
+#include "SwitchDescriptors.h"
+
+// Report IDs
+#define PROCON_IN_FULL 0x30
+#define PROCON_IN_SUBCMD_REPLY 0x21
+#define PROCON_IN_USB_REPLY 0x81
+#define PROCON_OUT_RUMBLE_SUBCMD 0x01
+#define PROCON_OUT_RUMBLE 0x10
+#define PROCON_OUT_USB 0x80
+
+// 0x80 USB commands
+#define PROCON_USB_STATUS 0x01
+#define PROCON_USB_HANDSHAKE 0x02
+#define PROCON_USB_BAUDRATE 0x03
+#define PROCON_USB_NO_TIMEOUT 0x04
+#define PROCON_USB_TIMEOUT 0x05
+
+// 0x01 subcommands
+#define PROCON_SUBCMD_PAIRING 0x01
+#define PROCON_SUBCMD_DEVICE_INFO 0x02
+#define PROCON_SUBCMD_INPUT_MODE 0x03
+#define PROCON_SUBCMD_TRIGGER_ELAPSED 0x04
+#define PROCON_SUBCMD_SPI_READ 0x10
+#define PROCON_SUBCMD_MCU_CONFIG 0x21
+#define PROCON_SUBCMD_PLAYER_LIGHTS 0x30
+#define PROCON_SUBCMD_ENABLE_IMU 0x40
+#define PROCON_SUBCMD_ENABLE_VIBRATION 0x48
+
+#define PROCON_INPUT_MODE_FULL 0x30
+
+// battery full, USB powered, Pro Controller
+#define PROCON_BATTERY_CONN 0x91
+#define PROCON_VIBRATOR_REPORT 0x80
+
+#define PROCON_SPI_READ_MAX 0x1D
+#define PROCON_REPLY_QUEUE 4
+
+//
+// Emulated SPI flash image, only the regions the console reads.
+// Everything else reads back as erased flash (0xFF).
+//
+typedef struct {
+	uint16_t addr;
+	uint8_t len;
+	const uint8_t *data;
+} SpiRegion;
+
+// 0x6020 factory IMU calibration: accel origin, accel sensitivity,
+// gyro origin, gyro sensitivity (int16 LE each axis)
+static const uint8_t spi_factory_imu[] = {
+	0xD3, 0xFF, 0xD5, 0xFF, 0x55, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+	0x19, 0x00, 0xDD, 0xFF, 0xDC, 0xFF, 0x3B, 0x34, 0x3B, 0x34, 0x3B, 0x34,
+};
+
+// 0x603D factory stick calibration, 12 bit pairs.
+// Left: max above center, center, min below center.
+// Right: center, min below center, max above center.
+// Range is +-0x600 around 0x800 on every axis.
+static const uint8_t spi_factory_sticks[] = {
+	0x00, 0x06, 0x60, 0x00, 0x08, 0x80, 0x00, 0x06, 0x60,
+	0x00, 0x08, 0x80, 0x00, 0x06, 0x60, 0x00, 0x06, 0x60,
+};
+
+// 0x6050 body, buttons, left grip, right grip colors
+static const uint8_t spi_colors[] = {
+	0x32, 0x32, 0x32, 0xFF, 0xFF, 0xFF, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+};
+
+// 0x6080 six axis horizontal offsets, then stick deadzone/range parameters
+static const uint8_t spi_sensor_params[] = {
+	0x50, 0xFD, 0x00, 0x00, 0xC6, 0x0F,
+	0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54,
+	0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63,
+};
+
+// 0x6098 right stick parameters
+static const uint8_t spi_stick2_params[] = {
+	0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54,
+	0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63,
+};
+
+// 0x6012 device type (Pro Controller), 0x601B color info present
+static const uint8_t spi_device_type[] = {0x03};
+static const uint8_t spi_color_info[] = {0x01};
+
+// 0x8010 user calibration stays erased, so the console uses factory data.
+static const SpiRegion spi_image[] = {
+	{0x6012, sizeof(spi_device_type), spi_device_type},
+	{0x601B, sizeof(spi_color_info), spi_color_info},
+	{0x6020, sizeof(spi_factory_imu), spi_factory_imu},
+	{0x603D, sizeof(spi_factory_sticks), spi_factory_sticks},
+	{0x6050, sizeof(spi_colors), spi_colors},
+	{0x6080, sizeof(spi_sensor_params), spi_sensor_params},
+	{0x6098, sizeof(spi_stick2_params), spi_stick2_params},
+};
+
+// HORI bit -> Pro Controller (byte, mask)
+typedef struct {
+	uint16_t switch_mask;
+	uint8_t byte;
+	uint8_t mask;
+} ButtonMap;
+
+static const ButtonMap HOT_DATA(button_map)[] = {
+	{SWITCH_MASK_Y, 0, 0x01},	  {SWITCH_MASK_X, 0, 0x02},
+	{SWITCH_MASK_B, 0, 0x04},	  {SWITCH_MASK_A, 0, 0x08},
+	{SWITCH_MASK_R, 0, 0x40},	  {SWITCH_MASK_ZR, 0, 0x80},
+	{SWITCH_MASK_MINUS, 1, 0x01}, {SWITCH_MASK_PLUS, 1, 0x02},
+	{SWITCH_MASK_R3, 1, 0x04},	  {SWITCH_MASK_L3, 1, 0x08},
+	{SWITCH_MASK_HOME, 1, 0x10},  {SWITCH_MASK_CAPTURE, 1, 0x20},
+	{SWITCH_MASK_L, 2, 0x40},	  {SWITCH_MASK_ZL, 2, 0x80},
+};
+
+// SWITCH_HAT_* -> down 0x01, up 0x02, right 0x04, left 0x08
+static const uint8_t HOT_DATA(hat_map)[] = {
+	0x02, 0x06, 0x04, 0x05, 0x01, 0x09, 0x08, 0x0A, 0x00,
+};
+
+typedef struct {
+	uint8_t len;
+	uint8_t data[PROCON_REPORT_SIZE];
+} PendingReply;
+
+static struct {
+	uint8_t mac[6];
+	uint8_t timer;
+	bool full_mode;
+	bool imu_enabled;
+	bool vibration_enabled;
+	uint8_t player_lights;
+	PendingReply replies[PROCON_REPLY_QUEUE];
+	uint8_t reply_head;
+	uint8_t reply_count;
+} procon;
+
+static PendingReply *
+queue_reply(void)
+{
+	if (procon.reply_count == PROCON_REPLY_QUEUE) {
+		// console is not reading, drop the oldest
+		procon.reply_head = (procon.reply_head + 1) % PROCON_REPLY_QUEUE;
+		procon.reply_count--;
+	}
+	uint8_t slot = (procon.reply_head + procon.reply_count) % PROCON_REPLY_QUEUE;
+	procon.reply_count++;
+
+	PendingReply *r = &procon.replies[slot];
+	memset(r->data, 0, sizeof(r->data));
+	r->len = PROCON_REPORT_SIZE;
+	return r;
+}
+
+static void
+spi_read(uint16_t addr, uint8_t len, uint8_t *out)
+{
+	memset(out, 0xFF, len);
+	for (unsigned i = 0; i < sizeof(spi_image) / sizeof(spi_image[0]); i++) {
+		const SpiRegion *reg = &spi_image[i];
+		for (uint8_t j = 0; j < reg->len; j++) {
+			uint16_t a = reg->addr + j;
+			if (a >= addr && a < addr + len)
+				out[a - addr] = reg->data[j];
+		}
+	}
+}
+
+static void
+HOT_FN(pack_stick)(uint8_t *out, uint16_t x, uint16_t y)
+{
+	out[0] = x & 0xFF;
+	out[1] = (x >> 8) | ((y & 0x0F) << 4);
+	out[2] = y >> 4;
+}
+
+// Fills bytes 2..12 shared by the 0x30 and 0x21 reports.
+static void
+HOT_FN(fill_input_state)(uint8_t *buf, const SwitchOutReport *state)
+{
+	buf[2] = PROCON_BATTERY_CONN;
+
+	uint8_t *buttons = &buf[3];
+	buttons[0] = buttons[1] = buttons[2] = 0;
+	for (unsigned i = 0; i < sizeof(button_map) / sizeof(button_map[0]); i++) {
+		if (state->buttons & button_map[i].switch_mask)
+			buttons[button_map[i].byte] |= button_map[i].mask;
+	}
+	if (state->hat <= SWITCH_HAT_NOTHING)
+		buttons[2] |= hat_map[state->hat];
+
+	// Pro Controller Y axis grows upwards
+	pack_stick(&buf[6], state->lx, SWITCH_STICK_MAX - state->ly);
+	pack_stick(&buf[9], state->rx, SWITCH_STICK_MAX - state->ry);
+
+	buf[12] = PROCON_VIBRATOR_REPORT;
+}
+
+static void
+reply_subcommand(uint8_t subcmd, uint8_t ack, const uint8_t *data, uint8_t len)
+{
+	PendingReply *r = queue_reply();
+	r->data[0] = PROCON_IN_SUBCMD_REPLY;
+	// input state (bytes 1..12) is filled at send time
+	r->data[13] = ack;
+	r->data[14] = subcmd;
+	if (len > PROCON_REPORT_SIZE - 15)
+		len = PROCON_REPORT_SIZE - 15;
+	if (data && len)
+		memcpy(&r->data[15], data, len);
+}
+
+static void
+reply_usb(uint8_t cmd, const uint8_t *data, uint8_t len)
+{
+	PendingReply *r = queue_reply();
+	r->data[0] = PROCON_IN_USB_REPLY;
+	r->data[1] = cmd;
+	if (data && len)
+		memcpy(&r->data[2], data, len);
+}
+
+static void
+handle_usb_command(uint8_t cmd)
+{
+	switch (cmd) {
+	case PROCON_USB_STATUS: {
+		// 0x00, controller type, MAC in reverse order
+		uint8_t status[8] = {0x00, 0x03};
+		for (int i = 0; i < 6; i++)
+			status[2 + i] = procon.mac[5 - i];
+		reply_usb(cmd, status, sizeof(status));
+		break;
+	}
+	case PROCON_USB_HANDSHAKE:
+	case PROCON_USB_BAUDRATE:
+		reply_usb(cmd, NULL, 0);
+		break;
+	case PROCON_USB_NO_TIMEOUT:
+		procon.full_mode = true;
+		break;
+	case PROCON_USB_TIMEOUT:
+		procon.full_mode = false;
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+handle_subcommand(uint8_t subcmd, const uint8_t *args, uint16_t args_len)
+{
+	switch (subcmd) {
+	case PROCON_SUBCMD_PAIRING: {
+		static const uint8_t paired[] = {0x03};
+		reply_subcommand(subcmd, 0x81, paired, sizeof(paired));
+		break;
+	}
+	case PROCON_SUBCMD_DEVICE_INFO: {
+		// firmware 3.139, Pro Controller, MAC, colors from SPI
+		uint8_t info[12] = {0x03, 0x8B, 0x03, 0x02};
+		memcpy(&info[4], procon.mac, 6);
+		info[10] = 0x01;
+		info[11] = 0x01;
+		reply_subcommand(subcmd, 0x82, info, sizeof(info));
+		break;
+	}
+	case PROCON_SUBCMD_INPUT_MODE:
+		if (args_len >= 1 && args[0] == PROCON_INPUT_MODE_FULL)
+			procon.full_mode = true;
+		reply_subcommand(subcmd, 0x80, NULL, 0);
+		break;
+	case PROCON_SUBCMD_TRIGGER_ELAPSED:
+		reply_subcommand(subcmd, 0x83, NULL, 0);
+		break;
+	case PROCON_SUBCMD_SPI_READ: {
+		if (args_len < 5)
+			break;
+		uint16_t addr = args[0] | (args[1] << 8);
+		uint8_t len = args[4];
+		if (len > PROCON_SPI_READ_MAX)
+			len = PROCON_SPI_READ_MAX;
+
+		// echo address and length, then the data
+		uint8_t out[5 + PROCON_SPI_READ_MAX];
+		memcpy(out, args, 4);
+		out[4] = len;
+		spi_read(addr, len, &out[5]);
+		reply_subcommand(subcmd, 0x90, out, 5 + len);
+		break;
+	}
+	case PROCON_SUBCMD_MCU_CONFIG: {
+		static const uint8_t mcu[] = {0x01, 0x00, 0xFF, 0x00, 0x08, 0x00, 0x1B, 0x01};
+		reply_subcommand(subcmd, 0xA0, mcu, sizeof(mcu));
+		break;
+	}
+	case PROCON_SUBCMD_PLAYER_LIGHTS:
+		if (args_len >= 1)
+			procon.player_lights = args[0];
+		reply_subcommand(subcmd, 0x80, NULL, 0);
+		break;
+	case PROCON_SUBCMD_ENABLE_IMU:
+		if (args_len >= 1)
+			procon.imu_enabled = args[0] != 0;
+		reply_subcommand(subcmd, 0x80, NULL, 0);
+		break;
+	case PROCON_SUBCMD_ENABLE_VIBRATION:
+		if (args_len >= 1)
+			procon.vibration_enabled = args[0] != 0;
+		reply_subcommand(subcmd, 0x80, NULL, 0);
+		break;
+	default:
+		// shipment mode, HCI state, IMU sensitivity, home light...
+		// plain ACK is enough for all of them
+		reply_subcommand(subcmd, 0x80, NULL, 0);
+		break;
+	}
+}
+
+void
+procon_init(const uint8_t mac[6])
+{
+	memset(&procon, 0, sizeof(procon));
+	memcpy(procon.mac, mac, 6);
+}
+
+void
+procon_handle_output(const uint8_t *buf, uint16_t len)
+{
+	if (!buf || len < 2)
+		return;
+
+	switch (buf[0]) {
+	case PROCON_OUT_USB:
+		handle_usb_command(buf[1]);
+		break;
+	case PROCON_OUT_RUMBLE_SUBCMD:
+		// [1] counter, [2..9] rumble, [10] subcommand, [11..] arguments
+		if (len >= 11)
+			handle_subcommand(buf[10], &buf[11], len - 11);
+		break;
+	case PROCON_OUT_RUMBLE:
+	default:
+		break;
+	}
+}
+
+static void
+HOT_FN(put_int16)(uint8_t *out, int16_t v)
+{
+	out[0] = (uint16_t) v & 0xFF;
+	out[1] = (uint16_t) v >> 8;
+}
+
+static void
+HOT_FN(fill_imu)(uint8_t *buf, const ProconImuSample *imu)
+{
+	uint8_t *out = &buf[13];
+	for (int i = 0; i < PROCON_IMU_SAMPLES; i++) {
+		for (int axis = 0; axis < 3; axis++)
+			put_int16(&out[axis * 2], imu[i].accel[axis]);
+		for (int axis = 0; axis < 3; axis++)
+			put_int16(&out[6 + axis * 2], imu[i].gyro[axis]);
+		out += 12;
+	}
+}
+
+uint16_t
+HOT_FN(procon_build_input)(uint8_t *buf,
+                   const SwitchOutReport *state,
+                   const ProconImuSample *imu)
+{
+	if (procon.reply_count) {
+		PendingReply *r = &procon.replies[procon.reply_head];
+		procon.reply_head = (procon.reply_head + 1) % PROCON_REPLY_QUEUE;
+		procon.reply_count--;
+
+		memcpy(buf, r->data, r->len);
+		if (buf[0] == PROCON_IN_SUBCMD_REPLY) {
+			buf[1] = procon.timer++;
+			fill_input_state(buf, state);
+		}
+		return r->len;
+	}
+
+	if (!procon.full_mode)
+		return 0;
+
+	memset(buf, 0, PROCON_REPORT_SIZE);
+	buf[0] = PROCON_IN_FULL;
+	buf[1] = procon.timer++;
+	fill_input_state(buf, state);
+	if (imu && procon.imu_enabled)
+		fill_imu(buf, imu);
+	return PROCON_REPORT_SIZE;
+}
+
+uint8_t
+procon_rumble_amplitude(const uint8_t *motor)
+{
+	// high band: amplitude in bits 7..1 of byte 1
+	int hi = motor[1] & 0xFE;
+	// low band: byte 3 biased by 0x40, its msb in bit 7 of byte 2
+	int lo = (((motor[2] & 0x80) << 1) | motor[3]) - 0x40;
+	if (lo < 0)
+		lo = 0;
+	if (lo > 0xFF)
+		lo = 0xFF;
+	return hi > lo ? hi : lo;
+}
+
+bool
+procon_full_mode(void)
+{
+	return procon.full_mode;
+}
+
+bool
+procon_wants_imu(void)
+{
+	return procon.full_mode && procon.imu_enabled && procon.reply_count == 0;
+}
@@ -0,0 +1,27 @@
+#include "profile.h"
+
+static AdapterProfile active_profile;
+
+void
+profile_init(void)
+{
+	active_profile.aim_mode = PROFILE_DEFAULT_AIM_MODE;
+	active_profile.gyro_mdeg_per_count = PROFILE_DEFAULT_GYRO_MDEG_PER_COUNT;
+	active_profile.gyro_invert_y = false;
+	active_profile.passthrough = PROFILE_DEFAULT_PASSTHROUGH;
+	active_profile.stick_mdeg_per_count = PROFILE_DEFAULT_STICK_MDEG_PER_COUNT;
+	// uncalibrated, mouse counts scale linearly to deflection
+	active_profile.turn_curve.max_rate_mdps = 0;
+}
+
+const AdapterProfile *
+profile_get(void)
+{
+	return &active_profile;
+}
+
+void
+profile_set_turn_curve(const TurnCurve *curve)
+{
+	active_profile.turn_curve = *curve;
+}
@@ -0,0 +1,218 @@
+#include "recovery.h"
+
+#include <string.h>
+
+#include <pico/platform.h>
+#include <pico/time.h>
+#include <hardware/watchdog.h>
+#include <btstack_run_loop.h>
+
+#include "sdkconfig.h"
+#include "stats.h"
+#include "slot.h"
+
+#define RECOVERY_MAGIC 0x52435631 // "RCV1"
+#define RECOVERY_DEVICES CONFIG_BLUEPAD32_MAX_DEVICES
+#define RECOVERY_USED 0x80
+
+typedef struct {
+	uint8_t addr[6];
+	uint8_t slot;
+	uint8_t flags; // RECOVERY_USED | RECOVERY_LEFT_STICK
+} SavedDevice;
+
+// Survives the watchdog reset. core0 owns the header, core1 the devices
+// and their checksum, so neither can tear the other's half.
+typedef struct {
+	uint32_t magic;
+	uint32_t resets;
+	uint32_t cause;
+	uint32_t stall_ms; // time lost before the reset
+	SavedDevice devices[RECOVERY_DEVICES];
+	uint32_t devices_sum;
+} RecoveryRecord;
+
+static RecoveryRecord __uninitialized_ram(record);
+
+volatile uint32_t recovery_core1_beats;
+
+// core0
+static bool after_watchdog;
+static uint32_t seen_beats;
+static uint32_t seen_beat_ms;
+
+// core1
+static btstack_timer_source_t heartbeat_timer;
+static uint32_t pending; // saved devices not back yet, bit per entry
+
+static uint32_t
+devices_checksum(void)
+{
+	const uint8_t *p = (const uint8_t *) record.devices;
+	uint32_t sum = RECOVERY_MAGIC;
+	for (size_t i = 0; i < sizeof(record.devices); i++)
+		sum = (sum << 5 | sum >> 27) ^ p[i];
+	return sum;
+}
+
+static uint32_t
+now_ms(void)
+{
+	return time_us_32() / 1000;
+}
+
+void
+recovery_init(void)
+{
+	after_watchdog = watchdog_enable_caused_reboot() && record.magic == RECOVERY_MAGIC;
+
+	if (after_watchdog) {
+		record.resets++;
+		STAT_SET(STAT_WATCHDOG_RESETS, record.resets);
+		STAT_SET(STAT_WATCHDOG_CAUSE, record.cause);
+		if (record.devices_sum != devices_checksum())
+			memset(record.devices, 0, sizeof(record.devices));
+	} else {
+		memset(&record, 0, sizeof(record));
+		record.magic = RECOVERY_MAGIC;
+	}
+	record.devices_sum = devices_checksum();
+
+	// what a trip without core0's involvement means
+	record.cause = RECOVERY_CAUSE_CORE0;
+	record.stall_ms = RECOVERY_WATCHDOG_MS;
+
+	watchdog_enable(RECOVERY_WATCHDOG_MS, true);
+}
+
+bool
+recovery_after_watchdog(void)
+{
+	return after_watchdog;
+}
+
+void
+recovery_core0_poll(void)
+{
+	uint32_t now = now_ms();
+	uint32_t beats = recovery_core1_beats;
+
+	if (beats != seen_beats) {
+		seen_beats = beats;
+		seen_beat_ms = now;
+	}
+
+	uint32_t limit = seen_beats ? RECOVERY_CORE1_TIMEOUT_MS : RECOVERY_CORE1_BOOT_MS;
+	uint32_t silent = now - seen_beat_ms;
+	if (silent > limit) {
+		// stop feeding, the watchdog takes it from here
+		record.cause = RECOVERY_CAUSE_CORE1;
+		record.stall_ms = silent + RECOVERY_WATCHDOG_MS;
+		while (1)
+			tight_loop_contents();
+	}
+
+	watchdog_update();
+}
+
+void
+recovery_usb_mounted(void)
+{
+	if (after_watchdog)
+		STAT_SET(STAT_RECOVERY_USB_MS, record.stall_ms + now_ms());
+}
+
+static void
+heartbeat_cb(btstack_timer_source_t *ts)
+{
+	recovery_core1_beats++;
+	btstack_run_loop_set_timer(ts, RECOVERY_HEARTBEAT_MS);
+	btstack_run_loop_add_timer(ts);
+}
+
+void
+recovery_start(void)
+{
+	if (after_watchdog) {
+		for (int i = 0; i < RECOVERY_DEVICES; i++) {
+			if (record.devices[i].flags & RECOVERY_USED)
+				pending |= 1u << i;
+		}
+		// nothing to wait for, the adapter is back once USB is
+		if (!pending)
+			STAT_SET(STAT_RECOVERY_MS, record.stall_ms + now_ms());
+	}
+
+	btstack_run_loop_set_timer_handler(&heartbeat_timer, heartbeat_cb);
+	btstack_run_loop_set_timer(&heartbeat_timer, RECOVERY_HEARTBEAT_MS);
+	btstack_run_loop_add_timer(&heartbeat_timer);
+	recovery_core1_beats++;
+}
+
+static int
+find(const uint8_t addr[6])
+{
+	for (int i = 0; i < RECOVERY_DEVICES; i++) {
+		if ((record.devices[i].flags & RECOVERY_USED) &&
+		    memcmp(record.devices[i].addr, addr, 6) == 0)
+			return i;
+	}
+	return -1;
+}
+
+void
+recovery_save_device(const uint8_t addr[6], uint8_t slot, uint8_t flags)
+{
+	int i = find(addr);
+	for (int j = 0; i < 0 && j < RECOVERY_DEVICES; j++) {
+		if (!(record.devices[j].flags & RECOVERY_USED))
+			i = j;
+	}
+	if (i < 0)
+		return;
+
+	memcpy(record.devices[i].addr, addr, 6);
+	record.devices[i].slot = slot;
+	record.devices[i].flags = flags | RECOVERY_USED;
+	record.devices_sum = devices_checksum();
+}
+
+void
+recovery_forget_device(const uint8_t addr[6])
+{
+	int i = find(addr);
+	if (i < 0)
+		return;
+
+	memset(&record.devices[i], 0, sizeof(record.devices[i]));
+	record.devices_sum = devices_checksum();
+	pending &= ~(1u << i);
+}
+
+bool
+recovery_saved_device(const uint8_t addr[6], uint8_t *slot, uint8_t *flags)
+{
+	int i = find(addr);
+	if (i < 0 || record.devices[i].slot >= SLOT_COUNT)
+		return false;
+
+	*slot = record.devices[i].slot;
+	*flags = record.devices[i].flags & ~RECOVERY_USED;
+	return true;
+}
+
+void
+recovery_on_report(const uint8_t addr[6])
+{
+	if (!pending)
+		return;
+
+	int i = find(addr);
+	if (i < 0 || !(pending & (1u << i)))
+		return;
+
+	// recovered once every device bound before the reset plays again
+	pending &= ~(1u << i);
+	if (!pending)
+		STAT_SET(STAT_RECOVERY_MS, record.stall_ms + now_ms());
+}
@@ -5,31 +5,112 @@
 #include <pico/multicore.h>
 #include <pico/async_context.h>
 #include <pico/cyw43_arch.h>
+#include <pico/time.h>
 #include <memory.h>
 
 #include "usb.h"
 #include "SwitchDescriptors.h"
+#include "trace.h"
+#include "stats.h"
+#include "hot.h"
+#include "dedup.h"
 
-// used between threads
-SwitchIdxOutReport shared_report;
+// async_context lock shared by both cores, waits show up in the trace
+static async_context_t *HOT_FN(lock_shared)(void) {
+    async_context_t *context = cyw43_arch_async_context();
+    TRACE_BEGIN(TRACE_LOCK_WAIT, 0);
+    async_context_acquire_lock_blocking(context);
+    TRACE_END(TRACE_LOCK_WAIT, 0);
+    return context;
+}
+
+// used between threads, neutral until core1 publishes
+SwitchIdxOutReport shared_report = {
+    .report = {
+        .hat = SWITCH_HAT_NOTHING,
+        .lx = SWITCH_STICK_MID,
+        .ly = SWITCH_STICK_MID,
+        .rx = SWITCH_STICK_MID,
+        .ry = SWITCH_STICK_MID,
+    },
+};
+static bool shared_report_fresh; // published, not read by core0 yet
 
-void set_global_gamepad_report(SwitchIdxOutReport *src) {
+// core1 only: what each pad last published, to drop repeats
+static PublishDedup CORE1_DATA(dedup);
+
+void HOT_FN(set_global_gamepad_report)(SwitchIdxOutReport *src) {
     if (!src) {
         return;
     }
 
-    async_context_t *context = cyw43_arch_async_context();
-    async_context_acquire_lock_blocking(context);
+    // e.g. a mouse move on an already saturated stick maps to the same state
+    if (!dedup_publish(&dedup, src)) {
+        STAT_INC(STAT_PUBLISH_SUPPRESSED);
+        return;
+    }
+
+    TRACE_BEGIN(TRACE_PUBLISH, src->idx);
+    async_context_t *context = lock_shared();
+    if (shared_report_fresh) {
+        STAT_INC(STAT_PUBLISH_OVERWRITTEN);
+        dedup_overwritten(&dedup, shared_report.idx, src->idx);
+    }
     memcpy(&shared_report, src, sizeof(shared_report));
+    shared_report.time_us = time_us_32();
+    shared_report_fresh = true;
     async_context_release_lock(context);
     multicore_fifo_push_timeout_us(0, 1);
+    TRACE_END(TRACE_PUBLISH, src->idx);
 }
 
 uint32_t unused;
-void get_global_gamepad_report(SwitchIdxOutReport *dest) {
+void HOT_FN(get_global_gamepad_report)(SwitchIdxOutReport *dest) {
     multicore_fifo_pop_timeout_us(1, &unused);
-    async_context_t *context = cyw43_arch_async_context();
-    async_context_acquire_lock_blocking(context);
+    async_context_t *context = lock_shared();
     memcpy(dest, &shared_report, sizeof(*dest));
+    shared_report_fresh = false;
+    async_context_release_lock(context);
+}
+
+// accumulated between USB reads, never overwritten
+MouseMotion shared_motion;
+
+void HOT_FN(add_global_mouse_motion)(int32_t dx, int32_t dy, int32_t wheel, uint8_t buttons) {
+    async_context_t *context = lock_shared();
+    shared_motion.dx += dx;
+    shared_motion.dy += dy;
+    shared_motion.wheel += wheel;
+    shared_motion.buttons = buttons;
+    async_context_release_lock(context);
+}
+
+void HOT_FN(take_global_mouse_motion)(MouseMotion *dest) {
+    async_context_t *context = lock_shared();
+    *dest = shared_motion;
+    shared_motion.dx = 0;
+    shared_motion.dy = 0;
+    shared_motion.wheel = 0;
+    async_context_release_lock(context);
+}
+
+PassthroughKeyboard shared_keyboard;
+bool shared_keyboard_changed;
+
+void set_global_keyboard_report(const PassthroughKeyboard *src) {
+    async_context_t *context = lock_shared();
+    if (memcmp(&shared_keyboard, src, sizeof(shared_keyboard)) != 0) {
+        shared_keyboard = *src;
+        shared_keyboard_changed = true;
+    }
+    async_context_release_lock(context);
+}
+
+bool get_global_keyboard_report(PassthroughKeyboard *dest) {
+    async_context_t *context = lock_shared();
+    bool changed = shared_keyboard_changed;
+    *dest = shared_keyboard;
+    shared_keyboard_changed = false;
     async_context_release_lock(context);
+    return changed;
 }
\ No newline at end of file
@@ -9,5 +9,6 @@
 #define CONFIG_BLUEPAD32_PLATFORM_CUSTOM
 #define CONFIG_TARGET_PICO_W
 
-// 2 == Info
-#define CONFIG_BLUEPAD32_LOG_LEVEL 2
+// 1 == Error. stdio is off, so higher levels only burn core1 cycles
+// formatting into nowhere; our own diagnostics go through dlog.h
+#define CONFIG_BLUEPAD32_LOG_LEVEL 1
@@ -0,0 +1,154 @@
+#include "slot.h"
+
+#include <string.h>
+
+#include "hot.h"
+
+#define BUTTON_BITS 16
+
+typedef struct {
+	uint8_t press_count[BUTTON_BITS]; // devices holding each button
+	int32_t axis_sum[4];              // lx, ly, rx, ry offsets from center
+	uint32_t hat_mask;                // devices with a hat direction
+	uint8_t devices;
+	SwitchOutReport report;
+} Slot;
+
+typedef struct {
+	uint8_t slot;
+	SwitchOutReport contribution;
+} Member;
+
+static Slot CORE1_DATA(slots)[SLOT_COUNT];
+static Member CORE1_DATA(members)[SLOT_MAX_DEVICES];
+
+static void
+neutral(SwitchOutReport *r)
+{
+	r->buttons = 0;
+	r->hat = SWITCH_HAT_NOTHING;
+	r->lx = SWITCH_STICK_MID;
+	r->ly = SWITCH_STICK_MID;
+	r->rx = SWITCH_STICK_MID;
+	r->ry = SWITCH_STICK_MID;
+}
+
+static uint16_t
+HOT_FN(clamp_axis)(int32_t offset)
+{
+	int32_t v = SWITCH_STICK_MID + offset;
+	if (v < SWITCH_STICK_MIN)
+		return SWITCH_STICK_MIN;
+	if (v > SWITCH_STICK_MAX)
+		return SWITCH_STICK_MAX;
+	return (uint16_t) v;
+}
+
+// Moves a slot from old to new for one device, touching only what changed
+static void
+HOT_FN(apply)(Slot *s, uint8_t device, const SwitchOutReport *old, const SwitchOutReport *new)
+{
+	uint16_t changed = old->buttons ^ new->buttons;
+	while (changed) {
+		int bit = __builtin_ctz(changed);
+		changed &= changed - 1;
+		uint16_t mask = 1u << bit;
+		if (new->buttons & mask) {
+			if (s->press_count[bit]++ == 0)
+				s->report.buttons |= mask;
+		} else {
+			if (--s->press_count[bit] == 0)
+				s->report.buttons &= ~mask;
+		}
+	}
+
+	s->axis_sum[0] += (int32_t) new->lx - old->lx;
+	s->axis_sum[1] += (int32_t) new->ly - old->ly;
+	s->axis_sum[2] += (int32_t) new->rx - old->rx;
+	s->axis_sum[3] += (int32_t) new->ry - old->ry;
+	s->report.lx = clamp_axis(s->axis_sum[0]);
+	s->report.ly = clamp_axis(s->axis_sum[1]);
+	s->report.rx = clamp_axis(s->axis_sum[2]);
+	s->report.ry = clamp_axis(s->axis_sum[3]);
+
+	if (new->hat != old->hat) {
+		if (new->hat == SWITCH_HAT_NOTHING)
+			s->hat_mask &= ~(1u << device);
+		else
+			s->hat_mask |= 1u << device;
+	}
+	s->report.hat = s->hat_mask ?
+	        members[__builtin_ctz(s->hat_mask)].contribution.hat : SWITCH_HAT_NOTHING;
+}
+
+void
+slot_init(void)
+{
+	memset(slots, 0, sizeof(slots));
+	for (int i = 0; i < SLOT_COUNT; i++)
+		neutral(&slots[i].report);
+	for (int i = 0; i < SLOT_MAX_DEVICES; i++) {
+		members[i].slot = SLOT_NONE;
+		neutral(&members[i].contribution);
+	}
+}
+
+void
+slot_bind(uint8_t device, uint8_t slot)
+{
+	if (device >= SLOT_MAX_DEVICES || slot >= SLOT_COUNT)
+		return;
+	slot_unbind(device);
+
+	members[device].slot = slot;
+	neutral(&members[device].contribution);
+	slots[slot].devices++;
+}
+
+uint8_t
+slot_unbind(uint8_t device)
+{
+	if (device >= SLOT_MAX_DEVICES || members[device].slot == SLOT_NONE)
+		return SLOT_NONE;
+
+	uint8_t slot = members[device].slot;
+	SwitchOutReport n;
+	neutral(&n);
+	slot_update(device, &n);
+
+	members[device].slot = SLOT_NONE;
+	slots[slot].devices--;
+	return slot;
+}
+
+uint8_t
+slot_of(uint8_t device)
+{
+	return device < SLOT_MAX_DEVICES ? members[device].slot : SLOT_NONE;
+}
+
+uint8_t
+HOT_FN(slot_update)(uint8_t device, const SwitchOutReport *contribution)
+{
+	if (device >= SLOT_MAX_DEVICES || members[device].slot == SLOT_NONE)
+		return SLOT_NONE;
+
+	Member *m = &members[device];
+	SwitchOutReport old = m->contribution;
+	// stored first, the hat lookup in apply() reads the new value
+	m->contribution = *contribution;
+	apply(&slots[m->slot], device, &old, contribution);
+	return m->slot;
+}
+
+uint8_t
+slot_device_count(uint8_t slot)
+{
+	return slot < SLOT_COUNT ? slots[slot].devices : 0;
+}
+
+const SwitchOutReport *
+HOT_FN(slot_report)(uint8_t slot)
+{
+	return &slots[slot].report;
+}
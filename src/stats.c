@@ -0,0 +1,25 @@
+#include "stats.h"
+
+volatile uint32_t adapter_stats[STAT_COUNT];
+
+_Static_assert(STAT_COUNT <= STATS_PAGES * STATS_PER_PAGE, "raise STATS_PAGES");
+
+uint16_t
+stats_fill_page(uint8_t page, uint8_t *buf, uint16_t len)
+{
+	uint32_t first = (uint32_t) page * STATS_PER_PAGE;
+	if (first >= STAT_COUNT)
+		return 0;
+
+	uint16_t n = 0;
+	for (uint32_t i = first; i < STAT_COUNT && i < first + STATS_PER_PAGE; i++) {
+		if (n + 4 > len)
+			break;
+		uint32_t v = adapter_stats[i];
+		buf[n++] = v & 0xFF;
+		buf[n++] = (v >> 8) & 0xFF;
+		buf[n++] = (v >> 16) & 0xFF;
+		buf[n++] = v >> 24;
+	}
+	return n;
+}
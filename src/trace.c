@@ -0,0 +1,73 @@
+#include "trace.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <pico/platform.h>
+#include <pico/time.h>
+
+typedef struct {
+	uint32_t head; // only touched by the recording core
+	uint32_t read; // host cursor while frozen
+	TraceRecord records[TRACE_RING_SIZE];
+} TraceRing;
+
+static TraceRing rings[2];
+static volatile bool frozen;
+
+void
+trace_record(uint8_t event, uint8_t phase, uint16_t arg)
+{
+	if (frozen)
+		return;
+
+	// flight recorder, the newest records overwrite the oldest
+	TraceRing *r = &rings[get_core_num()];
+	TraceRecord *rec = &r->records[r->head & (TRACE_RING_SIZE - 1)];
+	rec->time_us = time_us_32();
+	rec->event = event;
+	rec->phase = phase;
+	rec->arg = arg;
+	r->head++;
+}
+
+void
+trace_control(uint8_t cmd)
+{
+	if (cmd == TRACE_CMD_FREEZE) {
+		frozen = true;
+		__dmb();
+		// a record in flight on core1 lands long before the host reads
+		for (int i = 0; i < 2; i++) {
+			TraceRing *r = &rings[i];
+			r->read = r->head > TRACE_RING_SIZE ? r->head - TRACE_RING_SIZE : 0;
+		}
+	} else if (cmd == TRACE_CMD_RESUME) {
+		for (int i = 0; i < 2; i++)
+			rings[i].head = 0;
+		__dmb();
+		frozen = false;
+	}
+}
+
+uint16_t
+trace_fill_report(uint8_t core, uint8_t *buf, uint16_t len)
+{
+	if (core > 1 || len < 2)
+		return 0;
+
+	TraceRing *r = &rings[core];
+	uint32_t n = (len - 2) / sizeof(TraceRecord);
+	uint32_t avail = frozen ? r->head - r->read : 0;
+	if (n > avail)
+		n = avail;
+
+	buf[0] = n;
+	buf[1] = 0;
+	for (uint32_t i = 0; i < n; i++)
+		memcpy(&buf[2 + i * sizeof(TraceRecord)],
+		       &r->records[(r->read + i) & (TRACE_RING_SIZE - 1)], sizeof(TraceRecord));
+	r->read += n;
+
+	return 2 + n * sizeof(TraceRecord);
+}
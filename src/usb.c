@@ -3,19 +3,299 @@
 #include <tusb.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include <pico/stdlib.h>
 #include <pico/cyw43_arch.h>
 #include <pico/multicore.h>
 #include <pico/async_context.h>
 
+#include <pico/unique_id.h>
+#include <hardware/structs/usb.h>
+
 #include "report.h"
+#include "procon.h"
+#include "gyro.h"
+#include "profile.h"
+#include "osk.h"
+#include "move.h"
+#include "playback.h"
+#include "trace.h"
+#include "stats.h"
+#include "recovery.h"
+#include "hot.h"
+#include "cycles.h"
+#include "dedup.h"
 #include "SwitchDescriptors.h"
 
+// current USB frame, from the SOF frame counter
+static uint16_t CORE0_DATA(frame_number);
+static uint32_t CORE0_DATA(frame_start_us);
+static bool CORE0_DATA(frame_sent);
+static bool CORE0_DATA(frame_carry); // previous frame ended without a report
+// queue time within the frame, follows the IN completions
+static uint32_t CORE0_DATA(submit_offset_us) = USB_SUBMIT_OFFSET_US;
+
+// timing of the reports on the gamepad endpoints
+typedef struct {
+	uint32_t inflight_time_us; // publish time of the queued report, 0 for keepalives
+	uint32_t last_complete_us;
+	uint32_t last_interval_us;
+} InTiming;
+
+static InTiming CORE0_DATA(in_timing)[USB_HID_GAMEPADS];
+
+// collections further apart than this are separate bursts, not jitter
+#define STREAM_GAP_US 4000
+
+#if !SWITCH_PERSONALITY_PROCON
+// last report queued per pad, for change detection
+static SendDedup CORE0_DATA(send_dedup);
+#endif
+static uint32_t CORE0_DATA(age_avg_us);
+static uint32_t CORE0_DATA(interval_avg_us);
+static uint32_t CORE0_DATA(jitter_us16); // x16, RFC 3550 style smoothing
+static uint32_t CORE0_DATA(send_cycles_avg); // report read and queue
+
+// HID instance carrying the report, the Pro Controller only has one
+static inline uint8_t
+report_instance(const SwitchIdxOutReport *r)
+{
+#if SWITCH_PERSONALITY_PROCON
+	return 0;
+#else
+	return r->idx;
+#endif
+}
+
+// Returns false if the report was suppressed as a repeat
+static bool
+HOT_FN(send_report)(const SwitchIdxOutReport *r)
+{
+	in_timing[report_instance(r)].inflight_time_us = r->time_us;
+
+#if SWITCH_PERSONALITY_PROCON
+	uint8_t buf[PROCON_REPORT_SIZE];
+	ProconImuSample imu[PROCON_IMU_SAMPLES];
+	const ProconImuSample *motion = NULL;
+
+	// only drain the mouse when its motion actually goes out
+	if (procon_wants_imu()) {
+		const AdapterProfile *profile = profile_get();
+		MouseMotion m = {0};
+		if (profile->aim_mode == AIM_MODE_GYRO && !profile->passthrough)
+			take_global_mouse_motion(&m);
+		gyro_synthesize(m.dx, m.dy, imu);
+		motion = imu;
+	}
+
+	// 0x30 reports stream at the poll rate with a running timer and IMU,
+	// so the Pro Controller never suppresses
+	uint16_t len = procon_build_input(buf, &r->report, motion);
+	if (len) {
+		TRACE_INSTANT(TRACE_USB_SEND, report_instance(r));
+		tud_hid_n_report(report_instance(r), buf[0], &buf[1], len - 1);
+	}
+	return true;
+#else
+	SwitchReport out;
+	out.buttons = r->report.buttons;
+	out.hat = r->report.hat;
+	out.lx = SWITCH_STICK_TO_JOYSTICK(r->report.lx);
+	out.ly = SWITCH_STICK_TO_JOYSTICK(r->report.ly);
+	out.rx = SWITCH_STICK_TO_JOYSTICK(r->report.rx);
+	out.ry = SWITCH_STICK_TO_JOYSTICK(r->report.ry);
+	out.vendor = 0;
+
+	// the console keeps the last state it got, repeats only refresh it
+	uint32_t now_ms = time_us_32() / 1000;
+	DedupSend verdict = dedup_send(&send_dedup, r->idx, &out, now_ms);
+	if (verdict == DEDUP_SUPPRESS) {
+		STAT_INC(STAT_USB_SUPPRESSED);
+		return false;
+	}
+	if (verdict == DEDUP_KEEPALIVE) {
+		in_timing[r->idx].inflight_time_us = 0;
+		STAT_INC(STAT_USB_KEEPALIVES);
+	}
+
+	TRACE_INSTANT(TRACE_USB_SEND, r->idx);
+	// only what was actually queued counts as seen by the console
+	dedup_queued(&send_dedup, r->idx, &out, now_ms,
+	             tud_hid_n_report(r->idx, 0, &out, sizeof(out)));
+	return true;
+#endif
+}
+
+#if SWITCH_HID_PASSTHROUGH
+static int8_t
+HOT_FN(take_int8)(int32_t *v)
+{
+	int32_t out = *v;
+	if (out > INT8_MAX)
+		out = INT8_MAX;
+	else if (out < -INT8_MAX)
+		out = -INT8_MAX;
+	*v -= out;
+	return (int8_t) out;
+}
+
+// Raw keyboard and mouse to the boot interfaces. Mouse counts that do
+// not fit in one report are kept for the next one, nothing is dropped.
+static void
+HOT_FN(send_passthrough)(void)
+{
+	static PassthroughKeyboard kbd;
+	static bool kbd_pending;
+	static MouseMotion mouse;
+	static uint8_t sent_buttons;
+
+	if (!profile_get()->passthrough)
+		return;
+
+	if (get_global_keyboard_report(&kbd))
+		kbd_pending = true;
+	if (kbd_pending && tud_hid_n_ready(USB_HID_KEYBOARD)) {
+		tud_hid_n_keyboard_report(USB_HID_KEYBOARD, 0, kbd.modifiers, kbd.keys);
+		kbd_pending = false;
+	}
+
+	if (!tud_hid_n_ready(USB_HID_MOUSE))
+		return;
+
+	MouseMotion m;
+	take_global_mouse_motion(&m);
+	mouse.dx += m.dx;
+	mouse.dy += m.dy;
+	mouse.wheel += m.wheel;
+	mouse.buttons = m.buttons;
+
+	if (mouse.dx == 0 && mouse.dy == 0 && mouse.wheel == 0 &&
+	    mouse.buttons == sent_buttons)
+		return;
+
+	int8_t x = take_int8(&mouse.dx);
+	int8_t y = take_int8(&mouse.dy);
+	int8_t wheel = take_int8(&mouse.wheel);
+	tud_hid_n_mouse_report(USB_HID_MOUSE, 0, mouse.buttons, x, y, wheel, 0);
+	sent_buttons = mouse.buttons;
+}
+#endif
+
+// True once per frame when the report should be queued: at the deadline
+// inside the frame, or right away if the last frame went out empty.
+static bool
+HOT_FN(frame_due)(void)
+{
+	uint16_t frame = usb_hw->sof_rd & USB_SOF_RD_BITS;
+	uint32_t now = time_us_32();
+
+	if (frame != frame_number) {
+		frame_carry = !frame_sent;
+		frame_number = frame;
+		frame_start_us = now;
+		frame_sent = false;
+	}
+
+	return !frame_sent &&
+	       (frame_carry || now - frame_start_us >= submit_offset_us);
+}
+
+static void
+HOT_FN(smooth)(uint32_t *avg, uint32_t v)
+{
+	if (*avg == 0)
+		*avg = v;
+	else
+		*avg += ((int32_t) v - (int32_t) *avg) / 16;
+}
+
+// A completion marks the host's IN token, keepalives included: move the
+// submit time towards USB_SUBMIT_MARGIN_US before it. The phase is taken
+// modulo the frame, a token early in a frame puts the submit late in the
+// one before.
+static void
+HOT_FN(track_in_phase)(uint32_t now)
+{
+#if USB_SUBMIT_OFFSET_US
+	int32_t phase = (now - frame_start_us) % 1000;
+	int32_t target = (phase + 1000 - USB_SUBMIT_MARGIN_US) % 1000;
+	int32_t delta = target - (int32_t) submit_offset_us;
+	// the shorter way round the frame
+	if (delta >= 500)
+		delta -= 1000;
+	else if (delta < -500)
+		delta += 1000;
+	submit_offset_us = (submit_offset_us + 1000 + delta / 16) % 1000;
+	STAT_SET(STAT_USB_SUBMIT_OFFSET_US, submit_offset_us);
+#else
+	(void) now;
+#endif
+}
+
+void
+HOT_FN(tud_hid_report_complete_cb)(uint8_t instance, uint8_t const *report, uint16_t len)
+{
+	(void) report;
+	(void) len;
+	TRACE_INSTANT(TRACE_USB_IN_COMPLETE, instance);
+
+	if (instance >= USB_HID_GAMEPADS)
+		return;
+
+	InTiming *t = &in_timing[instance];
+	uint32_t now = time_us_32();
+	STAT_INC(STAT_USB_IN_REPORTS);
+	track_in_phase(now);
+
+	// keepalives repeat old data, they say nothing about latency
+	if (!t->inflight_time_us) {
+		t->last_complete_us = 0;
+		return;
+	}
+
+	uint32_t age = now - t->inflight_time_us;
+	int bucket = 0;
+	while (bucket < USB_AGE_BUCKETS - 1 && age >= (USB_AGE_BUCKET0_US << bucket))
+		bucket++;
+	STAT_INC(STAT_USB_AGE_HIST + bucket);
+	smooth(&age_avg_us, age);
+	STAT_SET(STAT_USB_AGE_AVG_US, age_avg_us);
+	STAT_MAX(STAT_USB_AGE_MAX_US, age);
+
+	uint32_t interval = now - t->last_complete_us;
+	bool streaming = t->last_complete_us != 0 && interval < STREAM_GAP_US;
+	t->last_complete_us = now;
+	if (!streaming) {
+		t->last_interval_us = 0;
+		return;
+	}
+
+	smooth(&interval_avg_us, interval);
+	STAT_SET(STAT_USB_INTERVAL_AVG_US, interval_avg_us);
+	STAT_MAX(STAT_USB_INTERVAL_MAX_US, interval);
+
+	if (t->last_interval_us) {
+		int32_t delta = (int32_t) interval - (int32_t) t->last_interval_us;
+		if (delta < 0)
+			delta = -delta;
+		jitter_us16 += delta - ((jitter_us16 + 8) >> 4);
+		STAT_SET(STAT_USB_JITTER_US, jitter_us16 >> 4);
+	}
+	t->last_interval_us = interval;
+}
+
 void
-usb_core_task()
+HOT_FN(usb_core_task)()
 {
+#if SWITCH_PERSONALITY_PROCON
+	pico_unique_board_id_t id;
+	pico_get_unique_board_id(&id);
+	procon_init(&id.id[PICO_UNIQUE_BOARD_ID_SIZE_BYTES - 6]);
+#endif
+
 	tusb_init();
+	move_init();
 
 	SwitchIdxOutReport r;
 	r.idx = 0;
@@ -27,27 +307,78 @@ usb_core_task()
 	r.report.ry = 0;
 
 	// send empty reports while bluepad32 is still not set
-	uint8_t runs =
-	        50;  // run for at least 5 seconds sending empty reports, garanteeing host will see the device
+	uint16_t runs =
+	        5000;  // run for at least 5 seconds sending empty reports, garanteeing host will see the device
+	// after a watchdog reset the host knows the device, get back to work
+	if (recovery_after_watchdog())
+		runs = 0;
 	while (multicore_fifo_get_status() & 1 == 0 || runs > 0) {
-		if (tud_hid_n_ready(r.idx)) {
-			tud_hid_n_report(r.idx, 0, &r.report, sizeof(r.report));
+		recovery_core0_poll();
+		// keep servicing the bus, the Pro Controller handshake starts right away
+		tud_task();
+		if (tud_hid_n_ready(report_instance(&r))) {
+			r.time_us = time_us_32();
+			send_report(&r);
 		}
 		runs--;
-		sleep_ms(100);
+		sleep_ms(1);
 	}
 
+	bool mounted = false;
 	while (1) {
-		get_global_gamepad_report(&r);
-
+		recovery_core0_poll();
+		TRACE_BEGIN(TRACE_USB_POLL, 0);
 		tud_task();
+		TRACE_END(TRACE_USB_POLL, 0);
+		if (!mounted && tud_mounted()) {
+			STAT_SET(STAT_BOOT_USB_MOUNTED_MS, time_us_32() / 1000);
+			recovery_usb_mounted();
+			mounted = true;
+		}
 		if (tud_suspended()) {
 			tud_remote_wakeup();
 			continue;
 		}
 
-		if (tud_hid_n_ready(r.idx)) {
-			tud_hid_n_report(r.idx, 0, &r.report, sizeof(r.report));
+#if SWITCH_HID_PASSTHROUGH
+		send_passthrough();
+#endif
+
+		if (!frame_due())
+			continue;
+
+		// read as late as possible, right before it is queued
+		uint32_t start = cycles_now();
+		get_global_gamepad_report(&r);
+
+		// a recording played from flash comes first, then on-screen
+		// keyboard typing takes over the first pad
+		SwitchIdxOutReport played;
+		SwitchIdxOutReport osk;
+		SwitchIdxOutReport *out = &r;
+		if (playback_next_frame(&r, &played, frame_number)) {
+			played.time_us = time_us_32();
+			out = &played;
+		} else if (osk_next_frame(&osk.report, frame_number)) {
+			osk.idx = 0;
+			osk.time_us = time_us_32();
+			out = &osk;
+		} else {
+			// WASD movement, one ramp step per frame
+			move_apply(r.idx, &r.report, frame_number);
+		}
+
+		if (tud_hid_n_ready(report_instance(out))) {
+			if (send_report(out) && frame_carry)
+				STAT_INC(STAT_USB_LATE_SUBMITS);
+			if (out == &played)
+				playback_sent(out);
+			frame_sent = true;
 		}
+
+		uint32_t cycles = cycles_since(start);
+		smooth(&send_cycles_avg, cycles);
+		STAT_SET(STAT_USB_SEND_CYCLES, send_cycles_avg);
+		STAT_MAX(STAT_USB_SEND_CYCLES_MAX, cycles);
 	}
 }
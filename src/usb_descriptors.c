@@ -26,6 +26,23 @@
 
 #include "tusb.h"
 #include "SwitchDescriptors.h"
+#include "ProconDescriptors.h"
+#include "procon.h"
+#include "usb.h"
+#include "stats.h"
+#include "dlog.h"
+#include "trace.h"
+#include "host_output.h"
+
+#if SWITCH_PERSONALITY_PROCON
+#define usb_device_descriptor procon_device_descriptor
+#define usb_report_descriptor procon_report_descriptor
+#define usb_string_descriptors procon_string_descriptors
+#else
+#define usb_device_descriptor switch_device_descriptor
+#define usb_report_descriptor switch_report_descriptor
+#define usb_string_descriptors switch_string_descriptors
+#endif
 
 /* A combination of interfaces must have a unique product id, since PC will save
  * device driver after the first plug. Same VID/PID with different interface e.g
@@ -45,7 +62,7 @@
 uint8_t const *
 tud_descriptor_device_cb(void)
 {
-	return switch_device_descriptor;
+	return usb_device_descriptor;
 }
 
 //--------------------------------------------------------------------+
@@ -55,26 +72,185 @@ tud_descriptor_device_cb(void)
 // Invoked when received GET HID REPORT DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
+#if SWITCH_HID_PASSTHROUGH
+static uint8_t const desc_hid_keyboard[] = {TUD_HID_REPORT_DESC_KEYBOARD()};
+static uint8_t const desc_hid_mouse[] = {TUD_HID_REPORT_DESC_MOUSE()};
+#endif
+
+#if ADAPTER_DIAG_INTERFACE
+// Vendor byte array feature report, GET_REPORT replies fill at most size
+#define DIAG_FEATURE(id, size)                                                 \
+	0x85, (id),   /*   Report ID */                                        \
+	0x09, 0x01,   /*   Usage (0x01) */                                     \
+	0x95, (size), /*   Report Count */                                     \
+	0xB1, 0x02    /*   Feature (Data,Var,Abs) */
+
+#define DIAG_REPORT_LEN (CFG_TUD_HID_EP_BUFSIZE - 1)
+#define DIAG_STATS_LEN (STATS_PER_PAGE * 4)
+
+static uint8_t const desc_hid_diag[] = {
+	0x06, 0x00, 0xFF, // Usage Page (Vendor Defined 0xFF00)
+	0x09, 0x01,       // Usage (0x01)
+	0xA1, 0x01,       // Collection (Application)
+	0x15, 0x00,       //   Logical Minimum (0)
+	0x26, 0xFF, 0x00, //   Logical Maximum (255)
+	0x75, 0x08,       //   Report Size (8)
+	DIAG_FEATURE(DLOG_REPORT_ID, DIAG_REPORT_LEN),
+	DIAG_FEATURE(DLOG_REPORT_ID + 1, DIAG_REPORT_LEN),
+	DIAG_FEATURE(TRACE_REPORT_ID, DIAG_REPORT_LEN),
+	DIAG_FEATURE(TRACE_REPORT_ID + 1, DIAG_REPORT_LEN),
+	// STATS_PAGES of them
+	DIAG_FEATURE(STATS_REPORT_ID + 0, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 1, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 2, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 3, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 4, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 5, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 6, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 7, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 8, DIAG_STATS_LEN),
+	DIAG_FEATURE(STATS_REPORT_ID + 9, DIAG_STATS_LEN),
+	0xC0, // End Collection
+};
+_Static_assert(STATS_PAGES == 10, "one DIAG_FEATURE per stats page");
+#endif
+
 uint8_t const *
 tud_hid_descriptor_report_cb(uint8_t instance)
 {
-	return switch_report_descriptor;
+#if SWITCH_HID_PASSTHROUGH
+	if (instance == USB_HID_KEYBOARD)
+		return desc_hid_keyboard;
+	if (instance == USB_HID_MOUSE)
+		return desc_hid_mouse;
+#endif
+#if ADAPTER_DIAG_INTERFACE
+	if (instance == USB_HID_DIAG)
+		return desc_hid_diag;
+#endif
+	return usb_report_descriptor;
 }
 
 //--------------------------------------------------------------------+
 // Configuration Descriptor
 //--------------------------------------------------------------------+
 
-enum { ITF_NUM_HID1, ITF_NUM_HID2, ITF_NUM_HID3, ITF_NUM_HID4, ITF_NUM_TOTAL };
+// Boot keyboard and mouse next to the gamepads, for titles that read
+// a real mouse. Interface and endpoint follow the last gamepad.
+#if SWITCH_HID_PASSTHROUGH
+#define PASSTHROUGH_DESC_LEN (TUD_HID_DESC_LEN + TUD_HID_DESC_LEN)
+#define PASSTHROUGH_DESCRIPTORS(itf, ep)                                       \
+	TUD_HID_DESCRIPTOR(itf,                                                \
+	                   0,                                                  \
+	                   HID_ITF_PROTOCOL_KEYBOARD,                          \
+	                   sizeof(desc_hid_keyboard),                          \
+	                   ep,                                                 \
+	                   CFG_TUD_HID_EP_BUFSIZE,                             \
+	                   1),                                                 \
+	TUD_HID_DESCRIPTOR(itf + 1,                                            \
+	                   0,                                                  \
+	                   HID_ITF_PROTOCOL_MOUSE,                             \
+	                   sizeof(desc_hid_mouse),                             \
+	                   ep + 1,                                             \
+	                   CFG_TUD_HID_EP_BUFSIZE,                             \
+	                   1)
+#else
+#define PASSTHROUGH_DESC_LEN 0
+#endif
+
+// Diagnostics interface after those, its IN endpoint never carries data
+#if ADAPTER_DIAG_INTERFACE
+#define DIAG_DESC_LEN TUD_HID_DESC_LEN
+#define DIAG_DESCRIPTOR(itf, ep)                                               \
+	TUD_HID_DESCRIPTOR(itf,                                                \
+	                   0,                                                  \
+	                   HID_ITF_PROTOCOL_NONE,                              \
+	                   sizeof(desc_hid_diag),                              \
+	                   ep,                                                 \
+	                   CFG_TUD_HID_EP_BUFSIZE,                             \
+	                   10)
+#else
+#define DIAG_DESC_LEN 0
+#endif
+
+#if SWITCH_PERSONALITY_PROCON
+
+// A single Pro Controller, interrupt IN and OUT
+enum {
+	ITF_NUM_HID1,
+#if SWITCH_HID_PASSTHROUGH
+	ITF_NUM_KEYBOARD,
+	ITF_NUM_MOUSE,
+#endif
+#if ADAPTER_DIAG_INTERFACE
+	ITF_NUM_DIAG,
+#endif
+	ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN                                                       \
+	(TUD_CONFIG_DESC_LEN + TUD_HID_INOUT_DESC_LEN + PASSTHROUGH_DESC_LEN + \
+	 DIAG_DESC_LEN)
+
+#define EPNUM_HID1_OUT 0x01
+#define EPNUM_HID1 0x81
+#define EPNUM_KEYBOARD 0x82
+#define EPNUM_DIAG (EPNUM_KEYBOARD + USB_HID_PASSTHROUGH)
+
+uint8_t const desc_configuration[] = {
+	// Config number, interface count, string index, total length, attribute, power in mA
+	TUD_CONFIG_DESCRIPTOR(1,
+	                      ITF_NUM_TOTAL,
+	                      0,
+	                      CONFIG_TOTAL_LEN,
+	                      TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP,
+	                      500),
+
+	// Interface number, string index, protocol, report descriptor len, EP Out & In address, size & polling interval
+	TUD_HID_INOUT_DESCRIPTOR(ITF_NUM_HID1,
+	                         0,
+	                         HID_ITF_PROTOCOL_NONE,
+	                         sizeof(procon_report_descriptor),
+	                         EPNUM_HID1_OUT,
+	                         EPNUM_HID1,
+	                         CFG_TUD_HID_EP_BUFSIZE,
+	                         1),
+#if SWITCH_HID_PASSTHROUGH
+	PASSTHROUGH_DESCRIPTORS(ITF_NUM_KEYBOARD, EPNUM_KEYBOARD),
+#endif
+#if ADAPTER_DIAG_INTERFACE
+	DIAG_DESCRIPTOR(ITF_NUM_DIAG, EPNUM_DIAG),
+#endif
+};
+
+#else
+
+enum {
+	ITF_NUM_HID1,
+	ITF_NUM_HID2,
+	ITF_NUM_HID3,
+	ITF_NUM_HID4,
+#if SWITCH_HID_PASSTHROUGH
+	ITF_NUM_KEYBOARD,
+	ITF_NUM_MOUSE,
+#endif
+#if ADAPTER_DIAG_INTERFACE
+	ITF_NUM_DIAG,
+#endif
+	ITF_NUM_TOTAL
+};
 
 #define CONFIG_TOTAL_LEN                                                       \
 	(TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN +           \
-	 TUD_HID_DESC_LEN + TUD_HID_DESC_LEN)
+	 TUD_HID_DESC_LEN + TUD_HID_DESC_LEN + PASSTHROUGH_DESC_LEN +          \
+	 DIAG_DESC_LEN)
 
 #define EPNUM_HID1 0x81
 #define EPNUM_HID2 0x82
 #define EPNUM_HID3 0x83
 #define EPNUM_HID4 0x84
+#define EPNUM_KEYBOARD 0x85
+#define EPNUM_DIAG (EPNUM_KEYBOARD + USB_HID_PASSTHROUGH)
 
 uint8_t const desc_configuration[] = {
 	// Config number, interface count, string index, total length, attribute, power in mA
@@ -113,9 +289,17 @@ uint8_t const desc_configuration[] = {
 	                   sizeof(switch_report_descriptor),
 	                   EPNUM_HID4,
 	                   CFG_TUD_HID_EP_BUFSIZE,
-	                   1)
+	                   1),
+#if SWITCH_HID_PASSTHROUGH
+	PASSTHROUGH_DESCRIPTORS(ITF_NUM_KEYBOARD, EPNUM_KEYBOARD),
+#endif
+#if ADAPTER_DIAG_INTERFACE
+	DIAG_DESCRIPTOR(ITF_NUM_DIAG, EPNUM_DIAG),
+#endif
 };
 
+#endif
+
 // Invoked when received GET CONFIGURATION DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
@@ -142,17 +326,17 @@ tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 	uint8_t chr_count;
 
 	if (index == 0) {
-		memcpy(&_desc_str[1], switch_string_descriptors[0], 2);
+		memcpy(&_desc_str[1], usb_string_descriptors[0], 2);
 		chr_count = 1;
 	} else {
 		// Note: the 0xEE index string is a Microsoft OS 1.0 Descriptors.
 		// https://docs.microsoft.com/en-us/windows-hardware/drivers/usbcon/microsoft-defined-usb-descriptors
 
-		if (!(index < sizeof(switch_string_descriptors) /
-		                      sizeof(switch_string_descriptors[0])))
+		if (!(index < sizeof(usb_string_descriptors) /
+		                      sizeof(usb_string_descriptors[0])))
 			return NULL;
 
-		const char *str = switch_string_descriptors[index];
+		const char *str = usb_string_descriptors[index];
 
 		// Cap at max char
 		chr_count = strlen(str);
@@ -171,6 +355,17 @@ tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 	return _desc_str;
 }
 
+// Interfaces answering the diagnostics feature reports, see usb.h
+static bool
+diag_instance(uint8_t instance)
+{
+#if ADAPTER_DIAG_INTERFACE
+	if (instance == USB_HID_DIAG)
+		return true;
+#endif
+	return instance == 0;
+}
+
 // Invoked when received GET_REPORT control request
 // Application must fill buffer report's content and return its length.
 // Return zero will cause the stack to STALL request
@@ -181,6 +376,21 @@ tud_hid_get_report_cb(uint8_t instance,
                       uint8_t *buffer,
                       uint16_t reqlen)
 {
+	if (!diag_instance(instance) || report_type != HID_REPORT_TYPE_FEATURE)
+		return 0;
+
+	// deferred log records, one report ID per core
+	if (report_id == DLOG_REPORT_ID || report_id == DLOG_REPORT_ID + 1)
+		return dlog_fill_report(report_id - DLOG_REPORT_ID, buffer, reqlen);
+
+	// frozen timeline trace, one report ID per core
+	if (report_id == TRACE_REPORT_ID || report_id == TRACE_REPORT_ID + 1)
+		return trace_fill_report(report_id - TRACE_REPORT_ID, buffer, reqlen);
+
+	// adapter statistics
+	if (report_id >= STATS_REPORT_ID)
+		return stats_fill_page(report_id - STATS_REPORT_ID, buffer, reqlen);
+
 	return 0;
 }
 
@@ -193,5 +403,30 @@ tud_hid_set_report_cb(uint8_t itf,
                       uint8_t const *buffer,
                       uint16_t bufsize)
 {
-	return;
+	if (diag_instance(itf) && report_type == HID_REPORT_TYPE_FEATURE &&
+	    report_id == TRACE_REPORT_ID) {
+		if (bufsize)
+			trace_control(buffer[bufsize > 1 && buffer[0] == report_id ? 1 : 0]);
+		return;
+	}
+
+	// keyboard LED reports of the passthrough interface are ignored
+	if (itf >= USB_HID_GAMEPADS)
+		return;
+
+	// OUT endpoint data starts with the report ID, SET_REPORT passes it apart
+	uint8_t out[CFG_TUD_HID_EP_BUFSIZE];
+	if (report_id != 0 && !(bufsize && buffer[0] == report_id)) {
+		if (bufsize > sizeof(out) - 1)
+			bufsize = sizeof(out) - 1;
+		out[0] = report_id;
+		memcpy(&out[1], buffer, bufsize);
+		buffer = out;
+		bufsize++;
+	}
+
+#if SWITCH_PERSONALITY_PROCON
+	procon_handle_output(buffer, bufsize);
+#endif
+	host_output_on_report(buffer, bufsize);
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+// Host timing for the per-event benchmarks. Numbers are printed for
+// comparison between two paths on the same machine, never asserted:
+// the host is not the RP2040 and ctest machines vary.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_ROUNDS 2000000
+
+// Keeps the compiler from dropping the benchmarked work
+static volatile uint32_t bench_sink;
+
+static inline uint64_t
+bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static inline void
+bench_report(const char *name, uint64_t start_ns, uint32_t events)
+{
+	double ns = (double) (bench_now_ns() - start_ns) / events;
+	printf("bench %-24s %8.2f ns/event\n", name, ns);
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+
+// Host test helpers. A failed CHECK prints where and carries on, main
+// returns TEST_DONE() so ctest sees the failure.
+
+static int test_failures;
+
+#define CHECK(cond)                                                            \
+	do {                                                                   \
+		if (!(cond)) {                                                 \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			test_failures++;                                       \
+		}                                                              \
+	} while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+	do {                                                                   \
+		long long a_ = (long long) (a), b_ = (long long) (b);          \
+		if (a_ != b_) {                                                \
+			printf("%s:%d: %s == %s failed, %lld != %lld\n", __FILE__, \
+			       __LINE__, #a, #b, a_, b_);                      \
+			test_failures++;                                       \
+		}                                                              \
+	} while (0)
+
+#define TEST_DONE() (test_failures ? 1 : 0)
+
+#endif
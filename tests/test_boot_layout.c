@@ -0,0 +1,277 @@
+#include <string.h>
+
+#include "bench.h"
+#include "boot_layout.h"
+#include "test.h"
+
+// HID boot keyboard, as in the HID spec appendix
+static const uint8_t keyboard[] = {
+	0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,
+	0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01,
+	0x75, 0x01, 0x95, 0x08, 0x81, 0x02,       // modifiers
+	0x95, 0x01, 0x75, 0x08, 0x81, 0x01,       // reserved
+	0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02, // LEDs
+	0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+	0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65,
+	0x05, 0x07, 0x19, 0x00, 0x29, 0x65, 0x81, 0x00, // keys
+	0xC0,
+};
+
+// Mouse with a report ID and a wheel
+static const uint8_t mouse[] = {
+	0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x02,
+	0x09, 0x01, 0xA1, 0x00,
+	0x05, 0x09, 0x19, 0x01, 0x29, 0x05, 0x15, 0x00, 0x25, 0x01,
+	0x95, 0x05, 0x75, 0x01, 0x81, 0x02,       // buttons
+	0x95, 0x01, 0x75, 0x03, 0x81, 0x01,       // padding
+	0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x38, 0x15, 0x81, 0x25, 0x7F,
+	0x75, 0x08, 0x95, 0x03, 0x81, 0x06,       // x, y, wheel, relative
+	0xC0, 0xC0,
+};
+
+static void
+test_boot_descriptors(void)
+{
+	BootLayout l;
+	CHECK(boot_layout_from_descriptor(keyboard, sizeof(keyboard), &l));
+	CHECK_EQ(l.kind, BOOT_LAYOUT_KEYBOARD);
+	CHECK_EQ(l.report_id, 0);
+
+	CHECK(boot_layout_from_descriptor(mouse, sizeof(mouse), &l));
+	CHECK_EQ(l.kind, BOOT_LAYOUT_MOUSE);
+	CHECK_EQ(l.report_id, 2);
+	CHECK(l.has_wheel);
+}
+
+static void
+test_truncated_descriptors(void)
+{
+	// every prefix of a valid descriptor is walked without reading past
+	// its end; none of them is a complete boot layout
+	BootLayout l;
+	for (int len = 0; len < (int) sizeof(keyboard) - 6; len++)
+		CHECK(!boot_layout_from_descriptor(keyboard, len, &l));
+	for (int len = 0; len < (int) sizeof(mouse) - 10; len++)
+		CHECK(!boot_layout_from_descriptor(mouse, len, &l));
+
+	// item whose data runs past the end
+	static const uint8_t short_item[] = {0x05, 0x01, 0x27, 0xFF};
+	CHECK(!boot_layout_from_descriptor(short_item, sizeof(short_item), &l));
+
+	// long item claiming more data than there is
+	static const uint8_t long_item[] = {0xFE, 0xF0, 0x00};
+	CHECK(!boot_layout_from_descriptor(long_item, sizeof(long_item), &l));
+	CHECK(!boot_layout_from_descriptor(long_item, 1, &l));
+}
+
+static void
+test_bad_indexes(void)
+{
+	BootLayout l;
+
+	// more report IDs than the walk keeps offsets for
+	uint8_t ids[2 * 12 + sizeof(keyboard)];
+	int n = 0;
+	for (int i = 1; i <= 12; i++) {
+		ids[n++] = 0x85;
+		ids[n++] = i;
+	}
+	for (unsigned i = 0; i < sizeof(keyboard); i++)
+		ids[n++] = keyboard[i];
+	CHECK(!boot_layout_from_descriptor(ids, n, &l));
+
+	// more usages than the walk keeps, the extra ones are dropped
+	uint8_t usages[64];
+	n = 0;
+	usages[n++] = 0x05;
+	usages[n++] = 0x01;
+	for (int i = 0; i < 20; i++) {
+		usages[n++] = 0x09;
+		usages[n++] = 0x40 + i;
+	}
+	usages[n++] = 0x75;
+	usages[n++] = 0x08;
+	usages[n++] = 0x95;
+	usages[n++] = 0x14;
+	usages[n++] = 0x81;
+	usages[n++] = 0x02;
+	CHECK(!boot_layout_from_descriptor(usages, n, &l));
+
+	// report count far beyond any report
+	static const uint8_t huge[] = {0x05, 0x01, 0x09, 0x30, 0x75, 0x08,
+	                               0x97, 0xFF, 0xFF, 0xFF, 0x7F, 0x81, 0x06};
+	CHECK(!boot_layout_from_descriptor(huge, sizeof(huge), &l));
+}
+
+// The generic path's way: walk the descriptor for every report and
+// pull each field out at its bit offset, as Bluepad32's HID parser does
+static int32_t
+field(const uint8_t *r, int len, uint32_t bit, uint32_t size, bool is_signed)
+{
+	uint32_t v = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		uint32_t at = bit + i;
+		if ((int) (at / 8) < len && (r[at / 8] >> (at % 8)) & 1)
+			v |= 1u << i;
+	}
+	if (is_signed && size < 32 && (v >> (size - 1)) & 1)
+		v |= ~0u << size;
+	return (int32_t) v;
+}
+
+static void
+generic_decode(const uint8_t *desc, int desc_len, const uint8_t *report, int len,
+               BootKeyboard *kb, BootMouse *mouse)
+{
+	uint32_t page = 0, size = 0, count = 0, id = 0, bit = 0;
+	uint32_t usages[8], n_usages = 0, usage_min = 0;
+	bool has_ids = false;
+	int n_keys = 0;
+
+	memset(kb, 0, sizeof(*kb));
+	memset(mouse, 0, sizeof(*mouse));
+	for (int i = 0; i < desc_len;) {
+		uint8_t prefix = desc[i];
+		int item_size = (prefix & 3) == 3 ? 4 : prefix & 3;
+		int type = (prefix >> 2) & 3, tag = prefix >> 4;
+		uint32_t value = 0;
+		for (int k = 0; k < item_size; k++)
+			value |= (uint32_t) desc[i + 1 + k] << (8 * k);
+		i += 1 + item_size;
+
+		if (type == 1) {
+			if (tag == 0)
+				page = value;
+			else if (tag == 7)
+				size = value;
+			else if (tag == 9)
+				count = value;
+			else if (tag == 8) {
+				id = value;
+				has_ids = true;
+				bit = 8;
+			}
+		} else if (type == 2) {
+			if (tag == 0 && n_usages < 8)
+				usages[n_usages++] = value;
+			else if (tag == 1)
+				usage_min = value;
+		} else if (type == 0) {
+			if (tag == 8 && !(value & 1) && (!has_ids || report[0] == id)) {
+				for (uint32_t k = 0; k < count; k++, bit += size) {
+					uint32_t usage = n_usages ? usages[k < n_usages ? k : n_usages - 1]
+					                          : usage_min + k;
+					if (page == 0x07 && (value & 2))
+						kb->modifiers |= field(report, len, bit, size, false) << (usage - 0xE0);
+					else if (page == 0x07 && n_keys < 6)
+						kb->keys[n_keys++] = field(report, len, bit, size, false);
+					else if (page == 0x09 && usage >= 1 && usage <= 8)
+						mouse->buttons |= field(report, len, bit, size, false) << (usage - 1);
+					else if (page == 0x01 && usage == 0x30)
+						mouse->x = field(report, len, bit, size, true);
+					else if (page == 0x01 && usage == 0x31)
+						mouse->y = field(report, len, bit, size, true);
+					else if (page == 0x01 && usage == 0x38)
+						mouse->wheel = field(report, len, bit, size, true);
+				}
+			} else if (tag == 8) {
+				bit += size * count;
+			}
+			n_usages = 0;
+			usage_min = 0;
+		}
+	}
+}
+
+// Reports recorded from a boot keyboard and a mouse with a report ID
+static const uint8_t keyboard_reports[][8] = {
+	{0x00, 0x00, 0x1A, 0x00, 0x00, 0x00, 0x00, 0x00}, // W
+	{0x02, 0x00, 0x1A, 0x04, 0x00, 0x00, 0x00, 0x00}, // shift W A
+	{0x01, 0x00, 0x2C, 0x08, 0x15, 0x00, 0x00, 0x00}, // ctrl space E R
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+
+static const uint8_t mouse_reports[][5] = {
+	{0x02, 0x00, 0x05, 0xFD, 0x00},
+	{0x02, 0x01, 0x80, 0x7F, 0x01},
+	{0x02, 0x05, 0xF0, 0x10, 0xFF},
+	{0x02, 0x00, 0x00, 0x00, 0x00},
+};
+
+#define N_KEYBOARD (sizeof(keyboard_reports) / sizeof(keyboard_reports[0]))
+#define N_MOUSE (sizeof(mouse_reports) / sizeof(mouse_reports[0]))
+
+static void
+test_decode_matches_generic(void)
+{
+	BootLayout kl, ml;
+	BootKeyboard kb, gkb;
+	BootMouse m, gm;
+
+	CHECK(boot_layout_from_descriptor(keyboard, sizeof(keyboard), &kl));
+	CHECK(boot_layout_from_descriptor(mouse, sizeof(mouse), &ml));
+
+	for (unsigned i = 0; i < N_KEYBOARD; i++) {
+		CHECK(boot_layout_keyboard(&kl, keyboard_reports[i], 8, &kb));
+		generic_decode(keyboard, sizeof(keyboard), keyboard_reports[i], 8, &gkb, &gm);
+		CHECK(memcmp(&kb, &gkb, sizeof(kb)) == 0);
+	}
+	for (unsigned i = 0; i < N_MOUSE; i++) {
+		CHECK(boot_layout_mouse(&ml, mouse_reports[i], 5, &m));
+		generic_decode(mouse, sizeof(mouse), mouse_reports[i], 5, &gkb, &gm);
+		CHECK(memcmp(&m, &gm, sizeof(m)) == 0);
+	}
+
+	// short reports and other report IDs are not decoded
+	CHECK(!boot_layout_keyboard(&kl, keyboard_reports[0], 7, &kb));
+	CHECK(!boot_layout_mouse(&ml, mouse_reports[0], 3, &m));
+	static const uint8_t other_id[] = {0x03, 0x01, 0x02, 0x03};
+	CHECK(!boot_layout_mouse(&ml, other_id, sizeof(other_id), &m));
+}
+
+// Per-report cost of the fast path against the descriptor walk, fewer
+// rounds than the other benchmarks as the walk is slow
+#define BOOT_BENCH_ROUNDS (BENCH_ROUNDS / 10)
+
+static void
+bench_decode(void)
+{
+	BootLayout kl, ml;
+	BootKeyboard kb;
+	BootMouse m;
+	uint32_t sink = 0;
+	uint64_t start;
+
+	boot_layout_from_descriptor(keyboard, sizeof(keyboard), &kl);
+	boot_layout_from_descriptor(mouse, sizeof(mouse), &ml);
+
+	start = bench_now_ns();
+	for (uint32_t i = 0; i < BOOT_BENCH_ROUNDS; i++) {
+		boot_layout_keyboard(&kl, keyboard_reports[i % N_KEYBOARD], 8, &kb);
+		boot_layout_mouse(&ml, mouse_reports[i % N_MOUSE], 5, &m);
+		sink += kb.modifiers + kb.keys[0] + m.buttons + m.x + m.wheel;
+	}
+	bench_report("boot fast path", start, 2 * BOOT_BENCH_ROUNDS);
+
+	start = bench_now_ns();
+	for (uint32_t i = 0; i < BOOT_BENCH_ROUNDS; i++) {
+		generic_decode(keyboard, sizeof(keyboard), keyboard_reports[i % N_KEYBOARD], 8, &kb, &m);
+		sink += kb.modifiers + kb.keys[0];
+		generic_decode(mouse, sizeof(mouse), mouse_reports[i % N_MOUSE], 5, &kb, &m);
+		sink += m.buttons + m.x + m.wheel;
+	}
+	bench_report("boot generic walk", start, 2 * BOOT_BENCH_ROUNDS);
+
+	bench_sink = sink;
+}
+
+int
+main(void)
+{
+	test_boot_descriptors();
+	test_truncated_descriptors();
+	test_bad_indexes();
+	test_decode_matches_generic();
+	bench_decode();
+	return TEST_DONE();
+}
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+
+#include "calib.h"
+#include "test.h"
+
+static uint16_t deflection[CALIB_PROBES];
+
+static void
+probes(void)
+{
+	for (int i = 0; i < CALIB_PROBES; i++)
+		deflection[i] = CALIB_FULL_DEFLECTION * (i + 1) / CALIB_PROBES;
+}
+
+static void
+check_monotone(const TurnCurve *c)
+{
+	for (int j = 1; j < CALIB_LUT_SIZE; j++)
+		CHECK(c->lut[j] >= c->lut[j - 1]);
+	CHECK(c->lut[CALIB_LUT_SIZE - 1] <= CALIB_FULL_DEFLECTION);
+
+	int32_t prev = 0;
+	for (int32_t rate = 0; rate <= (int32_t) c->max_rate_mdps + 1000; rate += 997) {
+		int32_t d = calib_deflection(c, rate);
+		CHECK(d >= prev);
+		CHECK_EQ(calib_deflection(c, -rate), -d);
+		prev = d;
+	}
+}
+
+static void
+test_noisy_rates_fit_monotone(void)
+{
+	// a badly timed turn in the middle
+	uint32_t rates[CALIB_PROBES] = {0, 0, 40000, 90000, 70000, 160000, 220000, 300000};
+	TurnCurve c;
+	probes();
+	CHECK(calib_fit(deflection, rates, CALIB_PROBES, &c));
+	CHECK_EQ(c.max_rate_mdps, 300000);
+	check_monotone(&c);
+
+	srand(1);
+	for (int t = 0; t < 1000; t++) {
+		for (int i = 0; i < CALIB_PROBES; i++)
+			rates[i] = (i < 2 ? 0 : 20000 * i) + rand() % 60000;
+		if (!calib_fit(deflection, rates, CALIB_PROBES, &c))
+			continue;
+		check_monotone(&c);
+	}
+}
+
+static void
+test_dead_zone_edge(void)
+{
+	// nothing below the third probe turns
+	uint32_t rates[CALIB_PROBES] = {0, 0, 30000, 60000, 90000, 120000, 150000, 180000};
+	TurnCurve c;
+	probes();
+	CHECK(calib_fit(deflection, rates, CALIB_PROBES, &c));
+	CHECK_EQ(c.lut[0], deflection[1]);
+	CHECK_EQ(c.lut[CALIB_LUT_SIZE - 1], CALIB_FULL_DEFLECTION);
+
+	// a linear response past the dead zone inverts linearly
+	int32_t mid = calib_deflection(&c, 90000);
+	CHECK(abs(mid - deflection[4]) <= 2);
+
+	uint32_t none[CALIB_PROBES] = {0};
+	CHECK(!calib_fit(deflection, none, CALIB_PROBES, &c));
+	CHECK(!calib_fit(deflection, rates, 0, &c));
+}
+
+static void
+test_deflection_saturates(void)
+{
+	uint32_t rates[CALIB_PROBES] = {10000, 20000, 30000, 40000, 50000, 60000, 70000, 80000};
+	TurnCurve c;
+	probes();
+	CHECK(calib_fit(deflection, rates, CALIB_PROBES, &c));
+	CHECK_EQ(calib_deflection(&c, 80000), CALIB_FULL_DEFLECTION);
+	CHECK_EQ(calib_deflection(&c, 5000000), CALIB_FULL_DEFLECTION);
+	CHECK_EQ(calib_deflection(&c, -5000000), -CALIB_FULL_DEFLECTION);
+	CHECK_EQ(calib_deflection(&c, 0), 0);
+
+	TurnCurve uncalibrated = {0};
+	CHECK_EQ(calib_deflection(&uncalibrated, 50000), 0);
+}
+
+int
+main(void)
+{
+	test_noisy_rates_fit_monotone();
+	test_dead_zone_edge();
+	test_deflection_saturates();
+	return TEST_DONE();
+}
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+
+#include "calib.h"
+#include "test.h"
+
+// calib.c built a second time with ADAPTER_FPU, symbols renamed in
+// CMakeLists.txt. Both builds have to turn the same mouse motion into
+// the same deflection, within one unit of rounding.
+int32_t fpu_calib_deflection(const TurnCurve *curve, int32_t rate_mdps);
+int32_t fpu_calib_mouse_deflection(const TurnCurve *curve, uint16_t mdeg_per_count,
+                                   int32_t delta, uint32_t interval_us);
+
+static uint16_t deflection[CALIB_PROBES];
+
+static void
+check_curve(const TurnCurve *c)
+{
+	for (int32_t rate = 0; rate <= (int32_t) c->max_rate_mdps + 5000; rate += 37) {
+		int32_t fixed = calib_deflection(c, rate);
+		int32_t fpu = fpu_calib_deflection(c, rate);
+		CHECK(abs(fixed - fpu) <= 1);
+		CHECK(abs(calib_deflection(c, -rate) - fpu_calib_deflection(c, -rate)) <= 1);
+	}
+
+	static const uint16_t mdeg[] = {1, 40, 250, 2000, UINT16_MAX};
+	static const uint32_t interval[] = {125, 1000, 4000, 8000, 40000};
+	for (unsigned m = 0; m < sizeof(mdeg) / sizeof(mdeg[0]); m++) {
+		for (unsigned i = 0; i < sizeof(interval) / sizeof(interval[0]); i++) {
+			for (int32_t delta = -300; delta <= 300; delta++) {
+				int32_t fixed = calib_mouse_deflection(c, mdeg[m], delta, interval[i]);
+				int32_t fpu = fpu_calib_mouse_deflection(c, mdeg[m], delta, interval[i]);
+				CHECK(abs(fixed - fpu) <= 1);
+			}
+			// saturates the same way far beyond int32 rates
+			CHECK_EQ(calib_mouse_deflection(c, mdeg[m], INT32_MAX, interval[i]),
+			         fpu_calib_mouse_deflection(c, mdeg[m], INT32_MAX, interval[i]));
+			CHECK_EQ(calib_mouse_deflection(c, mdeg[m], -INT32_MAX, interval[i]),
+			         fpu_calib_mouse_deflection(c, mdeg[m], -INT32_MAX, interval[i]));
+		}
+	}
+}
+
+int
+main(void)
+{
+	for (int i = 0; i < CALIB_PROBES; i++)
+		deflection[i] = CALIB_FULL_DEFLECTION * (i + 1) / CALIB_PROBES;
+
+	// dead zone, then accelerating like most games
+	uint32_t accel[CALIB_PROBES] = {0, 0, 20000, 50000, 100000, 170000, 260000, 380000};
+	// linear from the first probe
+	uint32_t linear[CALIB_PROBES] = {45000, 90000, 135000, 180000, 225000, 270000, 315000, 360000};
+	TurnCurve c;
+
+	CHECK(calib_fit(deflection, accel, CALIB_PROBES, &c));
+	check_curve(&c);
+	CHECK(calib_fit(deflection, linear, CALIB_PROBES, &c));
+	check_curve(&c);
+
+	srand(2);
+	for (int t = 0; t < 50; t++) {
+		uint32_t rates[CALIB_PROBES];
+		for (int i = 0; i < CALIB_PROBES; i++)
+			rates[i] = (i < 2 ? 0 : 30000 * i) + rand() % 60000;
+		if (calib_fit(deflection, rates, CALIB_PROBES, &c))
+			check_curve(&c);
+	}
+	return TEST_DONE();
+}
@@ -0,0 +1,134 @@
+#include <string.h>
+
+#include "dedup.h"
+#include "test.h"
+
+static SwitchIdxOutReport
+pad(uint8_t idx, uint16_t buttons)
+{
+	SwitchIdxOutReport r;
+	memset(&r, 0, sizeof(r));
+	r.idx = idx;
+	r.report.buttons = buttons;
+	r.report.hat = SWITCH_HAT_NOTHING;
+	r.report.lx = r.report.ly = r.report.rx = r.report.ry = SWITCH_STICK_MID;
+	return r;
+}
+
+static void
+test_publish_suppression(void)
+{
+	PublishDedup d;
+	memset(&d, 0, sizeof(d));
+
+	SwitchIdxOutReport a = pad(0, SWITCH_MASK_A);
+	CHECK(dedup_publish(&d, &a));
+	CHECK(!dedup_publish(&d, &a));
+
+	// same state on another pad is its own
+	SwitchIdxOutReport b = pad(1, SWITCH_MASK_A);
+	CHECK(dedup_publish(&d, &b));
+
+	a.report.lx = SWITCH_STICK_MAX;
+	CHECK(dedup_publish(&d, &a));
+	CHECK(!dedup_publish(&d, &a));
+
+	// outside the table, never dropped
+	SwitchIdxOutReport far = pad(USB_HID_GAMEPADS, 0);
+	CHECK(dedup_publish(&d, &far));
+	CHECK(dedup_publish(&d, &far));
+}
+
+static void
+test_cross_pad_overwrite(void)
+{
+	PublishDedup d;
+	memset(&d, 0, sizeof(d));
+
+	// pad 0 publishes, pad 1 overwrites it before core0 reads it
+	SwitchIdxOutReport a = pad(0, SWITCH_MASK_B);
+	SwitchIdxOutReport b = pad(1, SWITCH_MASK_X);
+	CHECK(dedup_publish(&d, &a));
+	CHECK(dedup_publish(&d, &b));
+	dedup_overwritten(&d, a.idx, b.idx);
+
+	// pad 0 repeating its lost state gets it through this time
+	CHECK(dedup_publish(&d, &a));
+	CHECK(!dedup_publish(&d, &a));
+	// pad 1's own state was not lost
+	CHECK(!dedup_publish(&d, &b));
+
+	// a pad overwriting its own unread report loses nothing
+	a.report.buttons = SWITCH_MASK_Y;
+	CHECK(dedup_publish(&d, &a));
+	dedup_overwritten(&d, a.idx, a.idx);
+	CHECK(!dedup_publish(&d, &a));
+}
+
+static SwitchReport
+hori(uint16_t buttons)
+{
+	SwitchReport r;
+	memset(&r, 0, sizeof(r));
+	r.buttons = buttons;
+	r.hat = SWITCH_HAT_NOTHING;
+	r.lx = r.ly = r.rx = r.ry = SWITCH_JOYSTICK_MID;
+	return r;
+}
+
+static void
+test_send_keepalive(void)
+{
+	SendDedup d;
+	memset(&d, 0, sizeof(d));
+	SwitchReport r = hori(SWITCH_MASK_A);
+
+	CHECK_EQ(dedup_send(&d, 0, &r, 1000), DEDUP_SEND);
+	dedup_queued(&d, 0, &r, 1000, true);
+
+	CHECK_EQ(dedup_send(&d, 0, &r, 1001), DEDUP_SUPPRESS);
+	CHECK_EQ(dedup_send(&d, 0, &r, 1000 + USB_KEEPALIVE_MS - 1), DEDUP_SUPPRESS);
+	CHECK_EQ(dedup_send(&d, 0, &r, 1000 + USB_KEEPALIVE_MS),
+	         USB_KEEPALIVE_MS ? DEDUP_KEEPALIVE : DEDUP_SUPPRESS);
+
+	// the keepalive restarts the interval
+	dedup_queued(&d, 0, &r, 1000 + USB_KEEPALIVE_MS, true);
+	CHECK_EQ(dedup_send(&d, 0, &r, 1001 + USB_KEEPALIVE_MS), DEDUP_SUPPRESS);
+
+	// a change goes out at once, other pads are separate
+	SwitchReport changed = hori(SWITCH_MASK_B);
+	CHECK_EQ(dedup_send(&d, 0, &changed, 1002 + USB_KEEPALIVE_MS), DEDUP_SEND);
+	CHECK_EQ(dedup_send(&d, 1, &r, 1002 + USB_KEEPALIVE_MS), DEDUP_SEND);
+
+	// the ms clock wraps
+	dedup_queued(&d, 2, &r, UINT32_MAX, true);
+	CHECK_EQ(dedup_send(&d, 2, &r, 0), DEDUP_SUPPRESS);
+}
+
+static void
+test_send_failed_queue(void)
+{
+	SendDedup d;
+	memset(&d, 0, sizeof(d));
+	SwitchReport r = hori(SWITCH_MASK_A);
+
+	// never queued: the console has not seen it, it is not a repeat
+	dedup_queued(&d, 0, &r, 1000, false);
+	CHECK_EQ(dedup_send(&d, 0, &r, 1001), DEDUP_SEND);
+
+	dedup_queued(&d, 0, &r, 1001, true);
+	SwitchReport changed = hori(SWITCH_MASK_B);
+	dedup_queued(&d, 0, &changed, 1002, false);
+	CHECK_EQ(dedup_send(&d, 0, &changed, 1003), DEDUP_SEND);
+	CHECK_EQ(dedup_send(&d, 0, &r, 1003), DEDUP_SUPPRESS);
+}
+
+int
+main(void)
+{
+	test_publish_suppression();
+	test_cross_pad_overwrite();
+	test_send_keepalive();
+	test_send_failed_queue();
+	return TEST_DONE();
+}
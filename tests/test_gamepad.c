@@ -0,0 +1,162 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "bench.h"
+#include "gamepad.h"
+#include "test.h"
+
+// convert_to_switch_axis before the table: 8-bit HORI units, deadzone
+// of 0xa around 0x80, all the arithmetic on every axis of every event
+#define OLD_AXIS_DEADZONE 0xa
+
+static uint8_t
+old_convert_to_switch_axis(int32_t bluepadAxis)
+{
+	bluepadAxis += 513;
+	bluepadAxis /= 4;
+
+	if (bluepadAxis < SWITCH_JOYSTICK_MIN)
+		bluepadAxis = 0;
+	else if ((bluepadAxis > (SWITCH_JOYSTICK_MID - OLD_AXIS_DEADZONE)) &&
+	         (bluepadAxis < (SWITCH_JOYSTICK_MID + OLD_AXIS_DEADZONE)))
+		bluepadAxis = SWITCH_JOYSTICK_MID;
+	else if (bluepadAxis > SWITCH_JOYSTICK_MAX)
+		bluepadAxis = SWITCH_JOYSTICK_MAX;
+
+	return (uint8_t) bluepadAxis;
+}
+
+static void
+test_axis_matches_old(void)
+{
+	for (int32_t a = -700; a < 700; a++) {
+		int old = old_convert_to_switch_axis(a);
+		int lut = SWITCH_STICK_TO_JOYSTICK(gamepad_axis(a));
+
+		// One axis step either side of the deadzone: the old edge
+		// was on the 8-bit value, the table's is on the 12-bit one
+		if (old == SWITCH_JOYSTICK_MID - OLD_AXIS_DEADZONE ||
+		    old == SWITCH_JOYSTICK_MID + OLD_AXIS_DEADZONE) {
+			CHECK((lut - old <= 1 && old - lut <= 1) || lut == SWITCH_JOYSTICK_MID);
+			continue;
+		}
+		CHECK(lut - old <= 1 && old - lut <= 1);
+	}
+}
+
+static void
+test_axis_ends_and_center(void)
+{
+	CHECK_EQ(gamepad_axis(-512), SWITCH_STICK_MIN);
+	CHECK_EQ(gamepad_axis(-100000), SWITCH_STICK_MIN);
+	CHECK_EQ(SWITCH_STICK_TO_JOYSTICK(gamepad_axis(511)), SWITCH_JOYSTICK_MAX);
+	CHECK_EQ(gamepad_axis(100000), SWITCH_STICK_MAX);
+	CHECK_EQ(gamepad_axis(0), SWITCH_STICK_MID);
+
+	// deadzone is exclusive at both edges, 4 units per axis step
+	for (int32_t a = -512; a < 512; a++) {
+		int v = (a + 512) * 4;
+		bool inside = v > SWITCH_STICK_MID - GAMEPAD_AXIS_DEADZONE &&
+		              v < SWITCH_STICK_MID + GAMEPAD_AXIS_DEADZONE;
+		if (inside)
+			CHECK_EQ(gamepad_axis(a), SWITCH_STICK_MID);
+		else
+			CHECK_EQ(gamepad_axis(a), v > SWITCH_STICK_MAX ? SWITCH_STICK_MAX : v);
+	}
+}
+
+static SwitchOutReport
+neutral(void)
+{
+	SwitchOutReport r;
+	memset(&r, 0, sizeof(r));
+	r.hat = SWITCH_HAT_NOTHING;
+	r.lx = r.ly = r.rx = r.ry = SWITCH_STICK_MID;
+	return r;
+}
+
+static void
+test_fill(void)
+{
+	SwitchOutReport r = neutral();
+	GamepadState gp = {0};
+
+	gp.buttons = GAMEPAD_BUTTON_A | GAMEPAD_BUTTON_SHOULDER_L | GAMEPAD_BUTTON_THUMB_R;
+	gp.misc_buttons = GAMEPAD_MISC_SYSTEM | GAMEPAD_MISC_START;
+	gp.dpad = GAMEPAD_DPAD_UP | GAMEPAD_DPAD_LEFT;
+	gp.axis_x = -512;
+	gp.axis_ry = 511;
+	gamepad_fill(&r, &gp);
+	CHECK_EQ(r.buttons, SWITCH_MASK_A | SWITCH_MASK_L | SWITCH_MASK_R3 |
+	                    SWITCH_MASK_HOME | SWITCH_MASK_PLUS);
+	CHECK_EQ(r.hat, SWITCH_HAT_UPLEFT);
+	CHECK_EQ(r.lx, SWITCH_STICK_MIN);
+	CHECK_EQ(r.ly, SWITCH_STICK_MID);
+	CHECK_EQ(SWITCH_STICK_TO_JOYSTICK(r.ry), SWITCH_JOYSTICK_MAX);
+
+	// analog triggers, ORed into what is already there
+	r = neutral();
+	r.buttons = SWITCH_MASK_B;
+	memset(&gp, 0, sizeof(gp));
+	gp.brake = 1;
+	gp.throttle = 1023;
+	gamepad_fill(&r, &gp);
+	CHECK_EQ(r.buttons, SWITCH_MASK_B | SWITCH_MASK_ZL | SWITCH_MASK_ZR);
+	CHECK_EQ(r.hat, SWITCH_HAT_NOTHING);
+
+	// opposite directions read as centered
+	gp.dpad = GAMEPAD_DPAD_LEFT | GAMEPAD_DPAD_RIGHT;
+	gamepad_fill(&r, &gp);
+	CHECK_EQ(r.hat, SWITCH_HAT_NOTHING);
+}
+
+// Per-event cost: the whole mapping, then its four axes through the
+// table against the old arithmetic
+static void
+bench_fill(void)
+{
+	GamepadState gp = {0};
+	SwitchOutReport r = neutral();
+	uint32_t sink = 0;
+	uint64_t start;
+
+	start = bench_now_ns();
+	for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+		gp.axis_x = (int32_t) (i & 1023) - 512;
+		gp.axis_ry = (int32_t) ((i * 31) & 1023) - 512;
+		gp.buttons = (uint16_t) i;
+		gp.dpad = (uint8_t) i;
+		gamepad_fill(&r, &gp);
+		sink += r.lx + r.ry + r.hat + r.buttons;
+	}
+	bench_report("gamepad_fill", start, BENCH_ROUNDS);
+
+	start = bench_now_ns();
+	for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+		int32_t a = (int32_t) (i & 1023) - 512;
+		sink += gamepad_axis(a) + gamepad_axis(-a) +
+		        gamepad_axis(a ^ 0x55) + gamepad_axis(a >> 1);
+	}
+	bench_report("4 axes, table", start, BENCH_ROUNDS);
+
+	start = bench_now_ns();
+	for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+		int32_t a = (int32_t) (i & 1023) - 512;
+		sink += old_convert_to_switch_axis(a) + old_convert_to_switch_axis(-a) +
+		        old_convert_to_switch_axis(a ^ 0x55) + old_convert_to_switch_axis(a >> 1);
+	}
+	bench_report("4 axes, arithmetic", start, BENCH_ROUNDS);
+
+	bench_sink = sink;
+}
+
+int
+main(void)
+{
+	gamepad_init();
+	test_axis_matches_old();
+	test_axis_ends_and_center();
+	test_fill();
+	bench_fill();
+	return TEST_DONE();
+}
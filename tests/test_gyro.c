@@ -0,0 +1,101 @@
+#include <stdlib.h>
+
+#include "gyro.h"
+#include "profile.h"
+#include "test.h"
+
+#define YAW 2
+#define PITCH 1
+
+// Feeds reports of mouse motion and integrates the samples back to an
+// angle in udeg, the way the console does
+static void
+integrate(const int32_t *dx, const int32_t *dy, int n, int64_t *yaw, int64_t *pitch)
+{
+	ProconImuSample s[PROCON_IMU_SAMPLES];
+	*yaw = 0;
+	*pitch = 0;
+	for (int i = 0; i < n; i++) {
+		gyro_synthesize(dx[i], dy[i], s);
+		for (int k = 0; k < PROCON_IMU_SAMPLES; k++) {
+			*yaw += (int64_t) s[k].gyro[YAW] * GYRO_UDEG_PER_LSB_SAMPLE;
+			*pitch += (int64_t) s[k].gyro[PITCH] * GYRO_UDEG_PER_LSB_SAMPLE;
+			CHECK_EQ(s[k].accel[2], GYRO_ACCEL_1G);
+			CHECK_EQ(s[k].gyro[0], 0);
+		}
+	}
+}
+
+static void
+test_small_motion_is_carried(void)
+{
+	// one count is less than one LSB sample, it has to add up instead of
+	// being rounded away report after report
+	int32_t dx[1000], dy[1000];
+	for (int i = 0; i < 1000; i++) {
+		dx[i] = 1;
+		dy[i] = -1;
+	}
+	int64_t yaw, pitch;
+	gyro_reset();
+	integrate(dx, dy, 1000, &yaw, &pitch);
+
+	int64_t expected = 1000LL * profile_get()->gyro_mdeg_per_count * 1000;
+	// mouse right turns right (negative yaw), mouse up looks up
+	CHECK(llabs(yaw + expected) < GYRO_UDEG_PER_LSB_SAMPLE);
+	CHECK(llabs(pitch - expected) < GYRO_UDEG_PER_LSB_SAMPLE);
+}
+
+static void
+test_mixed_motion_sums_up(void)
+{
+	int32_t dx[500], dy[500];
+	int64_t sum_x = 0, sum_y = 0;
+	srand(1);
+	for (int i = 0; i < 500; i++) {
+		dx[i] = rand() % 41 - 20;
+		dy[i] = rand() % 7 - 3;
+		sum_x += dx[i];
+		sum_y += dy[i];
+	}
+	int64_t yaw, pitch;
+	gyro_reset();
+	integrate(dx, dy, 500, &yaw, &pitch);
+
+	int64_t scale = (int64_t) profile_get()->gyro_mdeg_per_count * 1000;
+	CHECK(llabs(yaw + sum_x * scale) < GYRO_UDEG_PER_LSB_SAMPLE);
+	CHECK(llabs(pitch + sum_y * scale) < GYRO_UDEG_PER_LSB_SAMPLE);
+}
+
+static void
+test_saturated_sample_keeps_the_rest(void)
+{
+	// far beyond +-2000 dps: samples clip, the rest follows in later reports
+	int32_t dx[4] = {20000, 0, 0, 0};
+	int32_t dy[4] = {0};
+	ProconImuSample s[PROCON_IMU_SAMPLES];
+	gyro_reset();
+	gyro_synthesize(dx[0], dy[0], s);
+	CHECK_EQ(s[0].gyro[YAW], INT16_MIN);
+
+	int64_t yaw = 0;
+	for (int k = 0; k < PROCON_IMU_SAMPLES; k++)
+		yaw += (int64_t) s[k].gyro[YAW] * GYRO_UDEG_PER_LSB_SAMPLE;
+	for (int i = 0; i < 200; i++) {
+		gyro_synthesize(0, 0, s);
+		for (int k = 0; k < PROCON_IMU_SAMPLES; k++)
+			yaw += (int64_t) s[k].gyro[YAW] * GYRO_UDEG_PER_LSB_SAMPLE;
+	}
+	int64_t expected = -20000LL * profile_get()->gyro_mdeg_per_count * 1000;
+	CHECK(llabs(yaw - expected) < GYRO_UDEG_PER_LSB_SAMPLE);
+}
+
+int
+main(void)
+{
+	profile_init();
+	test_small_motion_is_carried();
+	test_mixed_motion_sums_up();
+	test_saturated_sample_keeps_the_rest();
+	return TEST_DONE();
+}
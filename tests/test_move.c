@@ -0,0 +1,82 @@
+#include "move.h"
+#include "KeyboardKeys.h"
+#include "test.h"
+
+static uint16_t frame;
+
+// Runs the pad long enough to settle any ramp, returns the stick
+static SwitchOutReport
+settle(uint8_t pad)
+{
+	SwitchOutReport r = {0};
+	for (int i = 0; i < MOVE_ACCEL_MS + MOVE_DECEL_MS + 2; i++) {
+		r.lx = SWITCH_STICK_MID;
+		r.ly = SWITCH_STICK_MID;
+		move_apply(pad, &r, ++frame);
+	}
+	return r;
+}
+
+static void
+keys(uint8_t device, uint8_t pad, uint8_t k0, uint8_t k1)
+{
+	uint8_t k[6] = {k0, k1};
+	move_keyboard_event(device, pad, 0, k, 6);
+}
+
+static void
+test_keyboards_merge_per_pad(void)
+{
+	keys(0, 0, KEY_W, 0);
+	keys(1, 0, KEY_W, 0);
+	SwitchOutReport r = settle(0);
+	CHECK_EQ(r.lx, SWITCH_STICK_MID);
+	CHECK(r.ly < SWITCH_STICK_MID - 1000);
+
+	// one keyboard letting go does not stop the other's W
+	keys(1, 0, 0, 0);
+	r = settle(0);
+	CHECK(r.ly < SWITCH_STICK_MID - 1000);
+
+	// directions of different keyboards combine
+	keys(1, 0, KEY_D, 0);
+	r = settle(0);
+	CHECK(r.lx > SWITCH_STICK_MID + 500);
+	CHECK(r.ly < SWITCH_STICK_MID - 500);
+
+	// releasing a device drops only its keys
+	move_release(0);
+	r = settle(0);
+	CHECK(r.lx > SWITCH_STICK_MID + 1000);
+	CHECK_EQ(r.ly, SWITCH_STICK_MID);
+
+	move_release(1);
+	r = settle(0);
+	CHECK_EQ(r.lx, SWITCH_STICK_MID);
+	CHECK_EQ(r.ly, SWITCH_STICK_MID);
+}
+
+static void
+test_device_moves_between_pads(void)
+{
+	keys(2, 0, KEY_A, 0);
+	CHECK(settle(0).lx < SWITCH_STICK_MID - 1000);
+
+	// the same device playing in another pad leaves the first one
+	keys(2, 1, KEY_A, 0);
+	CHECK_EQ(settle(0).lx, SWITCH_STICK_MID);
+	CHECK(settle(1).lx < SWITCH_STICK_MID - 1000);
+
+	// no pad releases as well
+	move_keyboard_event(2, 0xFF, 0, NULL, 0);
+	CHECK_EQ(settle(1).lx, SWITCH_STICK_MID);
+}
+
+int
+main(void)
+{
+	move_init();
+	test_keyboards_merge_per_pad();
+	test_device_moves_between_pads();
+	return TEST_DONE();
+}
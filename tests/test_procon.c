@@ -0,0 +1,139 @@
+#include <string.h>
+
+#include "procon.h"
+#include "test.h"
+
+static const uint8_t mac[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+static const SwitchOutReport neutral = {0, SWITCH_HAT_NOTHING, SWITCH_STICK_MID, SWITCH_STICK_MID,
+                                        SWITCH_STICK_MID, SWITCH_STICK_MID};
+
+// Sends subcommand subcmd, returns the 0x21 reply in buf
+static uint16_t
+subcommand(uint8_t subcmd, const uint8_t *args, int args_len, uint8_t *buf)
+{
+	uint8_t out[PROCON_REPORT_SIZE] = {0x01, 0x00, 0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40};
+	out[10] = subcmd;
+	memcpy(&out[11], args, args_len);
+	procon_handle_output(out, 11 + args_len);
+	return procon_build_input(buf, &neutral, NULL);
+}
+
+static void
+test_usb_handshake(void)
+{
+	uint8_t buf[PROCON_REPORT_SIZE];
+	static const uint8_t status[] = {0x80, 0x01};
+	procon_handle_output(status, sizeof(status));
+	CHECK_EQ(procon_build_input(buf, &neutral, NULL), PROCON_REPORT_SIZE);
+	CHECK_EQ(buf[0], 0x81);
+	CHECK_EQ(buf[1], 0x01);
+	CHECK_EQ(buf[3], 0x03); // Pro Controller
+	CHECK_EQ(buf[4], 0x66); // MAC reversed
+	CHECK_EQ(buf[9], 0x11);
+
+	// nothing to send until the console asks for full mode
+	CHECK_EQ(procon_build_input(buf, &neutral, NULL), 0);
+	static const uint8_t no_timeout[] = {0x80, 0x04};
+	procon_handle_output(no_timeout, sizeof(no_timeout));
+	CHECK(procon_full_mode());
+	CHECK_EQ(procon_build_input(buf, &neutral, NULL), PROCON_REPORT_SIZE);
+	CHECK_EQ(buf[0], 0x30);
+}
+
+static void
+test_subcommand_acks(void)
+{
+	uint8_t buf[PROCON_REPORT_SIZE];
+	static const struct {
+		uint8_t subcmd;
+		uint8_t ack;
+	} acks[] = {
+		{0x01, 0x81}, // pairing
+		{0x02, 0x82}, // device info
+		{0x03, 0x80}, // input mode
+		{0x04, 0x83}, // trigger elapsed
+		{0x21, 0xA0}, // MCU config
+		{0x30, 0x80}, // player lights
+		{0x40, 0x80}, // IMU
+		{0x48, 0x80}, // vibration
+		{0x08, 0x80}, // shipment mode, plain ACK
+	};
+	static const uint8_t arg = 0x01;
+
+	for (unsigned i = 0; i < sizeof(acks) / sizeof(acks[0]); i++) {
+		CHECK_EQ(subcommand(acks[i].subcmd, &arg, 1, buf), PROCON_REPORT_SIZE);
+		CHECK_EQ(buf[0], 0x21);
+		CHECK_EQ(buf[13], acks[i].ack);
+		CHECK_EQ(buf[14], acks[i].subcmd);
+	}
+
+	// device info: firmware, type, then the MAC in order
+	subcommand(0x02, NULL, 0, buf);
+	CHECK_EQ(buf[15], 0x03);
+	CHECK_EQ(buf[16], 0x8B);
+	CHECK_EQ(buf[17], 0x03);
+	CHECK(memcmp(&buf[19], mac, 6) == 0);
+}
+
+static void
+test_spi_read(void)
+{
+	uint8_t buf[PROCON_REPORT_SIZE];
+	// factory stick calibration, 0x603D, 18 bytes
+	static const uint8_t args[] = {0x3D, 0x60, 0x00, 0x00, 0x12};
+	CHECK_EQ(subcommand(0x10, args, sizeof(args), buf), PROCON_REPORT_SIZE);
+	CHECK_EQ(buf[13], 0x90);
+	CHECK_EQ(buf[14], 0x10);
+	CHECK(memcmp(&buf[15], args, sizeof(args)) == 0);
+
+	// reads past the console's limit are cut to 0x1D bytes
+	static const uint8_t big[] = {0x00, 0x60, 0x00, 0x00, 0xFF};
+	subcommand(0x10, big, sizeof(big), buf);
+	CHECK_EQ(buf[19], 0x1D);
+}
+
+static void
+test_reply_carries_state(void)
+{
+	uint8_t buf[PROCON_REPORT_SIZE];
+	uint8_t out[12] = {0x01, 0x00, 0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40, 0x30, 0x01};
+	SwitchOutReport pressed = neutral;
+	pressed.buttons = SWITCH_MASK_A;
+	procon_handle_output(out, sizeof(out));
+	procon_build_input(buf, &pressed, NULL);
+	CHECK_EQ(buf[0], 0x21);
+	CHECK(buf[3] & 0x08); // A, right byte
+}
+
+static void
+test_rumble_amplitude(void)
+{
+	static const uint8_t neutral[4] = {0x00, 0x01, 0x40, 0x40};
+	CHECK_EQ(procon_rumble_amplitude(neutral), 0);
+
+	// low band only, with and without its msb
+	static const uint8_t low[4] = {0x00, 0x01, 0x60, 0x72};
+	CHECK_EQ(procon_rumble_amplitude(low), 0x32);
+	static const uint8_t low_msb[4] = {0x00, 0x01, 0xE0, 0x72};
+	CHECK_EQ(procon_rumble_amplitude(low_msb), 0xFF);
+
+	// high band only
+	static const uint8_t high[4] = {0x00, 0xC9, 0x40, 0x40};
+	CHECK_EQ(procon_rumble_amplitude(high), 0xC8);
+
+	// below the bias is silent
+	static const uint8_t zero[4] = {0x00, 0x00, 0x00, 0x00};
+	CHECK_EQ(procon_rumble_amplitude(zero), 0);
+}
+
+int
+main(void)
+{
+	procon_init(mac);
+	test_usb_handshake();
+	test_subcommand_acks();
+	test_spi_read();
+	test_reply_carries_state();
+	test_rumble_amplitude();
+	return TEST_DONE();
+}
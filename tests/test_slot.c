@@ -0,0 +1,138 @@
+#include "slot.h"
+#include "test.h"
+
+static SwitchOutReport
+neutral(void)
+{
+	SwitchOutReport r = {0};
+	r.hat = SWITCH_HAT_NOTHING;
+	r.lx = r.ly = r.rx = r.ry = SWITCH_STICK_MID;
+	return r;
+}
+
+static void
+test_buttons_are_press_counted(void)
+{
+	slot_init();
+	slot_bind(0, 0);
+	slot_bind(1, 0);
+
+	SwitchOutReport a = neutral(), b = neutral();
+	a.buttons = SWITCH_MASK_A;
+	b.buttons = SWITCH_MASK_A | SWITCH_MASK_B;
+	slot_update(0, &a);
+	slot_update(1, &b);
+	CHECK_EQ(slot_report(0)->buttons, SWITCH_MASK_A | SWITCH_MASK_B);
+
+	// releasing A on one device keeps it held by the other
+	b.buttons = SWITCH_MASK_B;
+	slot_update(1, &b);
+	CHECK_EQ(slot_report(0)->buttons, SWITCH_MASK_A | SWITCH_MASK_B);
+
+	a.buttons = 0;
+	slot_update(0, &a);
+	CHECK_EQ(slot_report(0)->buttons, SWITCH_MASK_B);
+
+	// unbinding drops what the device still held
+	slot_unbind(1);
+	CHECK_EQ(slot_report(0)->buttons, 0);
+	CHECK_EQ(slot_device_count(0), 1);
+
+	// other slots are untouched
+	CHECK_EQ(slot_report(1)->buttons, 0);
+}
+
+static void
+test_hat_lowest_device_wins(void)
+{
+	slot_init();
+	slot_bind(3, 1);
+	slot_bind(5, 1);
+
+	SwitchOutReport low = neutral(), high = neutral();
+	high.hat = SWITCH_HAT_LEFT;
+	slot_update(5, &high);
+	CHECK_EQ(slot_report(1)->hat, SWITCH_HAT_LEFT);
+
+	low.hat = SWITCH_HAT_UP;
+	slot_update(3, &low);
+	CHECK_EQ(slot_report(1)->hat, SWITCH_HAT_UP);
+
+	// a change of the lower device's direction shows through
+	low.hat = SWITCH_HAT_DOWN;
+	slot_update(3, &low);
+	CHECK_EQ(slot_report(1)->hat, SWITCH_HAT_DOWN);
+
+	low.hat = SWITCH_HAT_NOTHING;
+	slot_update(3, &low);
+	CHECK_EQ(slot_report(1)->hat, SWITCH_HAT_LEFT);
+
+	slot_unbind(5);
+	CHECK_EQ(slot_report(1)->hat, SWITCH_HAT_NOTHING);
+}
+
+static void
+test_sticks_sum_and_clamp(void)
+{
+	slot_init();
+	slot_bind(0, 2);
+	slot_bind(1, 2);
+
+	SwitchOutReport a = neutral(), b = neutral();
+	a.lx = SWITCH_STICK_MID + 0x300;
+	b.lx = SWITCH_STICK_MID + 0x200;
+	b.ry = SWITCH_STICK_MID - 0x100;
+	slot_update(0, &a);
+	slot_update(1, &b);
+	CHECK_EQ(slot_report(2)->lx, SWITCH_STICK_MID + 0x500);
+	CHECK_EQ(slot_report(2)->ry, SWITCH_STICK_MID - 0x100);
+
+	a.lx = SWITCH_STICK_MAX;
+	b.lx = SWITCH_STICK_MAX;
+	a.ly = SWITCH_STICK_MIN;
+	b.ly = SWITCH_STICK_MIN;
+	slot_update(0, &a);
+	slot_update(1, &b);
+	CHECK_EQ(slot_report(2)->lx, SWITCH_STICK_MAX);
+	CHECK_EQ(slot_report(2)->ly, SWITCH_STICK_MIN);
+
+	// the running sum stays exact past the clamp
+	a = neutral();
+	slot_update(0, &a);
+	CHECK_EQ(slot_report(2)->lx, SWITCH_STICK_MAX);
+	CHECK_EQ(slot_report(2)->ly, SWITCH_STICK_MIN);
+	b = neutral();
+	slot_update(1, &b);
+	CHECK_EQ(slot_report(2)->lx, SWITCH_STICK_MID);
+	CHECK_EQ(slot_report(2)->ly, SWITCH_STICK_MID);
+}
+
+static void
+test_rebind_moves_device(void)
+{
+	slot_init();
+	slot_bind(2, 0);
+	SwitchOutReport a = neutral();
+	a.buttons = SWITCH_MASK_A;
+	CHECK_EQ(slot_update(2, &a), 0);
+
+	slot_bind(2, 3);
+	CHECK_EQ(slot_of(2), 3);
+	CHECK_EQ(slot_report(0)->buttons, 0);
+	CHECK_EQ(slot_report(3)->buttons, 0);
+	CHECK_EQ(slot_device_count(0), 0);
+	CHECK_EQ(slot_device_count(3), 1);
+
+	CHECK_EQ(slot_update(SLOT_MAX_DEVICES, &a), SLOT_NONE);
+	CHECK_EQ(slot_unbind(7), SLOT_NONE);
+}
+
+int
+main(void)
+{
+	test_buttons_are_press_counted();
+	test_hat_lowest_device_wins();
+	test_sticks_sum_and_clamp();
+	test_rebind_moves_device();
+	return TEST_DONE();
+}
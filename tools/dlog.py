@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Drain and format the adapter's deferred log (see include/dlog.h).
+
+Records carry the address of their format string; the string itself is
+read from the firmware ELF, so pass the exact build that is flashed.
+Needs the hidapi and pyelftools modules: pip install hidapi pyelftools
+
+    tools/dlog.py build/SwitchKMAdapter.elf --follow
+"""
+import argparse
+import re
+import struct
+import time
+
+from elftools.elf.elffile import ELFFile
+
+from stats import DEVICES, open_adapter
+
+DLOG_REPORT_ID = 0x38
+RECORD = struct.Struct("<6I")
+
+# printf conversion, flags/width/precision kept, length modifiers dropped
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class Strings:
+    """C strings at target addresses, from the ELF's loadable sections."""
+
+    def __init__(self, path):
+        self.sections = []
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            for s in elf.iter_sections():
+                if s["sh_type"] == "SHT_PROGBITS" and s["sh_flags"] & 0x2:
+                    self.sections.append((s["sh_addr"], s.data()))
+
+    def get(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                end = data.find(b"\0", addr - base)
+                return data[addr - base : end].decode("utf-8", "replace")
+        return None
+
+
+def format_record(strings, fmt_addr, args):
+    fmt = strings.get(fmt_addr)
+    if fmt is None:
+        return "<unknown format 0x%08x> %s" % (fmt_addr, " ".join("0x%x" % a for a in args))
+
+    it = iter(args)
+
+    def convert(m):
+        spec, conv = m.groups()
+        if conv == "%":
+            return "%"
+        value = next(it, 0)
+        if conv in "di":
+            return ("%" + spec + "d") % struct.unpack("<i", struct.pack("<I", value))[0]
+        if conv == "p":
+            return "0x%08x" % value
+        if conv == "s":
+            s = strings.get(value)
+            return ("%" + spec + "s") % (s if s is not None else "<str 0x%08x>" % value)
+        if conv == "u":
+            conv = "d"
+        return ("%" + spec + conv) % value
+
+    return CONVERSION.sub(convert, fmt.rstrip("\n"))
+
+
+def drain(dev, core):
+    records = []
+    while True:
+        data = bytes(dev.get_feature_report(DLOG_REPORT_ID + core, 64))[1:]
+        if len(data) < 2:
+            break
+        count, dropped = data[0], data[1]
+        if dropped:
+            records.append((None, core, "<%d records dropped>" % dropped))
+        for i in range(count):
+            fmt, t, *args = RECORD.unpack_from(data, 2 + i * RECORD.size)
+            records.append((t, core, (fmt, args)))
+        if count == 0:
+            break
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF matching the flashed build")
+    parser.add_argument("--personality", choices=DEVICES, default="hori")
+    parser.add_argument("--follow", action="store_true", help="keep polling")
+    args = parser.parse_args()
+
+    strings = Strings(args.elf)
+    dev = open_adapter(args.personality)
+
+    while True:
+        records = drain(dev, 0) + drain(dev, 1)
+        # both rings share the microsecond timer, merge them in time order
+        # (drop notices have no timestamp and come first)
+        records.sort(key=lambda r: r[0] if r[0] is not None else 0)
+        for t, core, body in records:
+            if t is None:
+                print("%12s  core%d  %s" % ("", core, body))
+            else:
+                print("%12.6f  core%d  %s" % (t / 1e6, core, format_record(strings, *body)))
+        if not args.follow:
+            break
+        time.sleep(0.1)
+
+
+if __name__ == "__main__":
+    main()
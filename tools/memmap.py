@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Static RAM or flash usage per module from the linker map.
+
+Sums the input sections of every object file in the GNU ld map written
+next to the ELF (SwitchKMAdapter.elf.map) and prints them by module,
+largest first. Objects from archives are grouped by library.
+RAM counts initialized data (.data, code and tables copied to SRAM, the
+scratch banks) and .bss; --flash counts code, constants and the initial
+values of the copied sections, i.e. what has to be read from flash.
+
+    tools/memmap.py build/SwitchKMAdapter.elf.map
+    tools/memmap.py --flash build/SwitchKMAdapter.elf.map
+"""
+import argparse
+import collections
+import os
+import re
+
+# " .bss.name  0x20001234  0x40 path/obj" on one line, or the section name
+# alone when it is too long and the numbers follow on the next line
+SECTION = re.compile(r"^ (\.[a-z_]+[^\s]*)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(.*))?$")
+
+# column names and the input section prefixes counted in each
+COPIED = (".data", ".time_critical", ".scratch_x", ".scratch_y")
+RAM_COLUMNS = (("data", COPIED), ("bss", (".bss",)))
+FLASH_COLUMNS = (("code", (".text",)), ("const", (".rodata", ".big_const")), ("init", COPIED))
+CONTINUATION = re.compile(r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(.*)$")
+
+
+def module_name(path, by_object):
+    # libfoo.a(bar.c.obj)
+    m = re.match(r"(.*)\((.*)\)$", path)
+    if m:
+        lib = os.path.basename(m.group(1))
+        return "%s(%s)" % (lib, m.group(2)) if by_object else lib
+    name = os.path.basename(path)
+    if not by_object and "/CMakeFiles/" in path:
+        # SDK and Bluepad32 sources built into our target, group by library dir
+        for part in ("bluepad32", "btstack", "tinyusb", "cyw43-driver", "pico-sdk"):
+            if "/%s/" % part in path or "_%s" % part in path:
+                return part
+    return name
+
+
+def parse(path, by_object, columns):
+    usage = collections.defaultdict(lambda: [0] * len(columns))
+    in_memory_map = False
+    pending = None
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("Linker script and memory map"):
+                in_memory_map = True
+                continue
+            if not in_memory_map:
+                continue
+
+            if pending:
+                m = CONTINUATION.match(line)
+                if m:
+                    add(usage, columns, pending, m.group(2), m.group(3), by_object)
+                pending = None
+                continue
+
+            m = SECTION.match(line)
+            if not m:
+                continue
+            if m.group(2) is None:
+                pending = m.group(1)
+                continue
+            add(usage, columns, m.group(1), m.group(3), m.group(4), by_object)
+    return usage
+
+
+def add(usage, columns, section, size, obj, by_object):
+    size = int(size, 16)
+    if size == 0:
+        return
+    for kind, (_, prefixes) in enumerate(columns):
+        if section.startswith(prefixes):
+            usage[module_name(obj.strip(), by_object)][kind] += size
+            return
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--objects", action="store_true",
+                        help="one line per object file instead of per library")
+    parser.add_argument("--top", type=int, default=0, help="only the N largest")
+    parser.add_argument("--flash", action="store_true", help="flash instead of RAM")
+    args = parser.parse_args()
+
+    columns = FLASH_COLUMNS if args.flash else RAM_COLUMNS
+    usage = parse(args.map, args.objects, columns)
+    rows = sorted(usage.items(), key=lambda kv: -sum(kv[1]))
+    if args.top:
+        rows = rows[: args.top]
+
+    names = [name for name, _ in columns]
+    print(("%-48s" + " %8s" * (len(names) + 1)) % ("module", *names, "total"))
+    totals = [0] * len(columns)
+    for name, sizes in rows:
+        print(("%-48s" + " %8d" * (len(sizes) + 1)) % (name[-48:], *sizes, sum(sizes)))
+        totals = [t + v for t, v in zip(totals, sizes)]
+    print(("%-48s" + " %8d" * (len(totals) + 1)) % ("total", *totals, sum(totals)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Build a playback recording for the adapter's flash (see include/playback.h).
+
+Reads a text script, one record per line, '#' starts a comment:
+
+    <frames> pad <pad> <buttons> <hat> <lx> <ly> <rx> <ry>
+    <frames> key <pad> <device> <modifiers> [key ...]
+    <frames> mouse <pad> <device> <dx> <dy> [wheel] [buttons]
+
+frames counts USB frames (1 ms) after the previous record. Numbers take
+any Python integer syntax (0x10, 0b101). Sticks are 12-bit, 0x800 is
+center; hat 8 is neutral. The output goes next to the firmware:
+
+    tools/playback.py session.txt -o session.bin
+    picotool load -o 0x10100000 session.bin
+"""
+import argparse
+import struct
+import sys
+
+PLAYBACK_MAGIC = 0x31424C50
+PLAYBACK_FLASH_OFFSET = 1024 * 1024
+XIP_BASE = 0x10000000
+# BTstack keeps its link keys in the last two sectors
+FLASH_BANK_SIZE = 2 * 4096
+
+PLAYBACK_PAD = 0
+PLAYBACK_KEYBOARD = 1
+PLAYBACK_MOUSE = 2
+
+HEADER = struct.Struct("<II")
+# frames, kind, pad, device, 11 bytes of payload
+RECORD = struct.Struct("<HBBB11s")
+PAD = struct.Struct("<HBHHHH")
+KEYBOARD = struct.Struct("<B6B4x")
+MOUSE = struct.Struct("<hhbB5x")
+
+
+def record(fields):
+    frames, kind, pad = int(fields[0], 0), fields[1], int(fields[2], 0)
+    args = [int(v, 0) for v in fields[3:]]
+    if kind == "pad":
+        return RECORD.pack(frames, PLAYBACK_PAD, pad, 0, PAD.pack(*args))
+    if kind == "key":
+        device, modifiers, keys = args[0], args[1], args[2:8]
+        keys += [0] * (6 - len(keys))
+        return RECORD.pack(frames, PLAYBACK_KEYBOARD, pad, device,
+                           KEYBOARD.pack(modifiers, *keys))
+    if kind == "mouse":
+        device, rest = args[0], args[1:] + [0] * (5 - len(args))
+        return RECORD.pack(frames, PLAYBACK_MOUSE, pad, device, MOUSE.pack(*rest[:4]))
+    raise ValueError("unknown record kind %r" % kind)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("script")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--flash-size", type=lambda v: int(v, 0), default=2 * 1024 * 1024,
+                        help="flash size of the board (default 2 MB, Pico W; 4 MB on Pico 2 W)")
+    args = parser.parse_args()
+
+    records = []
+    with open(args.script) as f:
+        for n, line in enumerate(f, 1):
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            try:
+                records.append(record(fields))
+            except (ValueError, IndexError, struct.error) as e:
+                sys.exit("%s:%d: %s" % (args.script, n, e))
+
+    size = HEADER.size + RECORD.size * len(records)
+    limit = args.flash_size - FLASH_BANK_SIZE - PLAYBACK_FLASH_OFFSET
+    if size > limit:
+        sys.exit("%d bytes do not fit in the %d before the BTstack flash bank, at most %d records"
+                 % (size, limit, (limit - HEADER.size) // RECORD.size))
+
+    with open(args.output, "wb") as f:
+        f.write(HEADER.pack(PLAYBACK_MAGIC, len(records)))
+        f.write(b"".join(records))
+
+    print("%d records, %d bytes" % (len(records), size))
+    print("picotool load -o 0x%08x %s" % (XIP_BASE + PLAYBACK_FLASH_OFFSET, args.output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Read the adapter statistics over USB.
+
+Counters are served as HID feature reports, report ID 0x40 + page,
+15 little-endian uint32 per page (see stats.h). The first gamepad
+interface serves them on Linux; Windows and macOS need a build with
+ADAPTER_DIAG_INTERFACE, whose vendor interface declares the reports.
+Needs the hidapi module: pip install hidapi
+"""
+import argparse
+import struct
+
+import hid
+
+STATS_REPORT_ID = 0x40
+STATS_PER_PAGE = 15
+
+# Same order as the enum in include/stats.h
+STAT_NAMES = [
+    "host_out_received",
+    "host_out_forwarded",
+    "host_out_device_writes",
+    "boot_reports",
+    "boot_cycles",
+    "generic_reports",
+    "generic_cycles",
+]
+
+# Per link blocks, LINK_STAT_* in include/stats.h
+LINK_STAT_SLOTS = 4
+LINK_FIELDS = [
+    "addr",
+    "protocol",
+    "interval_us",
+    "latency",
+    "param_rejects",
+    "sniff_entries",
+    "rssi",
+    "reports",
+    "report_interval_us",
+    "jitter_us",
+    "max_gap_us",
+]
+STAT_NAMES += [
+    "link%d_%s" % (slot, field)
+    for slot in range(LINK_STAT_SLOTS)
+    for field in LINK_FIELDS
+]
+STAT_NAMES += [
+    "stack0_size",
+    "stack0_peak",
+    "stack1_size",
+    "stack1_peak",
+    "heap_arena",
+    "heap_peak",
+    "hci_connections_peak",
+    "bt_devices_peak",
+    "usb_in_reports",
+    "usb_age_avg_us",
+    "usb_age_max_us",
+    "usb_interval_avg_us",
+    "usb_jitter_us",
+    "usb_interval_max_us",
+    "usb_late_submits",
+    "publish_suppressed",
+    "usb_suppressed",
+    "usb_keepalives",
+    "publish_overwritten",
+]
+USB_AGE_BUCKETS = 8
+USB_AGE_BUCKET0_US = 250
+STAT_NAMES += [
+    "usb_age_lt_%dus" % (USB_AGE_BUCKET0_US << i) for i in range(USB_AGE_BUCKETS - 1)
+] + ["usb_age_older"]
+STAT_NAMES += [
+    "loadgen_events",
+    "loadgen_rate",
+    "loadgen_achieved_rate",
+    "loadgen_max_rate",
+    "loadgen_map_cycles",
+    "watchdog_resets",
+    "watchdog_cause",
+    "recovery_usb_ms",
+    "recovery_ms",
+    "map_cycles",
+    "map_cycles_max",
+    "usb_send_cycles",
+    "usb_send_cycles_max",
+    "xip_accesses",
+    "xip_misses",
+    "calib_probe",
+    "calib_max_rate_mdps",
+    "boot_cyw43_init_ms",
+    "boot_bt_ready_ms",
+    "boot_usb_mounted_ms",
+    "scan_on",
+    "scan_starts",
+    "admit_rejected",
+    "mouse_jitter_scan_us",
+    "mouse_jitter_idle_us",
+    "playback_state",
+    "playback_records",
+    "playback_dropped",
+    "usb_submit_offset_us",
+]
+
+DEVICES = {
+    "hori": (0x0F0D, 0x0092),
+    "procon": (0x057E, 0x2009),
+}
+
+
+# ADAPTER_DIAG_INTERFACE, see include/usb.h
+DIAG_USAGE_PAGE = 0xFF00
+DIAG_USAGE = 0x01
+
+
+def open_adapter(personality):
+    """The diagnostics interface if the build has one, else the first gamepad."""
+    vid, pid = DEVICES[personality]
+    infos = hid.enumerate(vid, pid)
+    diag = [i for i in infos
+            if i["usage_page"] == DIAG_USAGE_PAGE and i["usage"] == DIAG_USAGE]
+    first = [i for i in infos if i["interface_number"] in (0, -1)]
+    for info in diag + first:
+        dev = hid.device()
+        dev.open_path(info["path"])
+        return dev
+    raise SystemExit("adapter not found")
+
+
+def read_stats(dev):
+    values = []
+    page = 0
+    while len(values) < len(STAT_NAMES):
+        data = bytes(dev.get_feature_report(STATS_REPORT_ID + page, 64))
+        # hidapi returns the report ID first
+        payload = data[1:]
+        if not payload:
+            break
+        count = len(payload) // 4
+        values += struct.unpack("<%dI" % count, payload[: count * 4])
+        page += 1
+    return values
+
+
+def format_value(name, value):
+    if name.endswith("_addr"):
+        return "..:%02X:%02X:%02X:%02X" % tuple(value.to_bytes(4, "big"))
+    if name.endswith("_rssi"):
+        return "%d" % struct.unpack("<i", struct.pack("<I", value))[0]
+    return "%d" % value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--personality", choices=DEVICES, default="hori")
+    args = parser.parse_args()
+
+    values = read_stats(open_adapter(args.personality))
+    for name, value in zip(STAT_NAMES, values):
+        print("%-32s %s" % (name, format_value(name, value)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Capture the adapter's timeline trace as Chrome/Perfetto JSON.
+
+Clears the trace rings, lets them record for a while, freezes them, reads
+both cores and resumes. Open the output in https://ui.perfetto.dev or
+chrome://tracing. Events and their order match include/trace.h.
+Needs the hidapi module: pip install hidapi
+
+    tools/trace2chrome.py --seconds 2 -o trace.json
+"""
+import argparse
+import json
+import struct
+import time
+
+from stats import DEVICES, open_adapter
+
+TRACE_REPORT_ID = 0x3A
+TRACE_CMD_RESUME = 0
+TRACE_CMD_FREEZE = 1
+RECORD = struct.Struct("<IBBH")
+# declared length of the report on the diagnostics interface, Windows
+# rejects shorter feature writes
+REPORT_LEN = 63
+
+# Same order as TraceEvent in include/trace.h
+EVENTS = [
+    "bt_packet",
+    "map",
+    "publish",
+    "usb_poll",
+    "usb_send",
+    "usb_in_complete",
+    "lock_wait",
+]
+
+CORE_NAMES = ["core0 (USB)", "core1 (Bluetooth)"]
+
+
+def read_core(dev, core):
+    records = []
+    while True:
+        data = bytes(dev.get_feature_report(TRACE_REPORT_ID + core, 64))[1:]
+        if len(data) < 2 or data[0] == 0:
+            break
+        for i in range(data[0]):
+            records.append(RECORD.unpack_from(data, 2 + i * RECORD.size))
+    return records
+
+
+def to_chrome(per_core):
+    events = []
+    for core, name in enumerate(CORE_NAMES):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": core,
+                       "args": {"name": name}})
+
+    # the rings only span a moment of the 32-bit timer, so time relative to
+    # any one record, taken as signed, survives a wrap in between
+    refs = [recs[-1][0] for recs in per_core if recs]
+    if not refs:
+        return {"traceEvents": events}
+    ref = refs[0]
+
+    def relative(t):
+        return ((t - ref + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+
+    origin = min(relative(recs[0][0]) for recs in per_core if recs)
+    for core, records in enumerate(per_core):
+        for t, event, phase, arg in records:
+            e = {
+                "name": EVENTS[event] if event < len(EVENTS) else "event%d" % event,
+                "ph": chr(phase),
+                "ts": relative(t) - origin,
+                "pid": 0,
+                "tid": core,
+                "args": {"arg": arg},
+            }
+            if e["ph"] == "i":
+                e["s"] = "t"
+            events.append(e)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def control(dev, cmd):
+    dev.send_feature_report([TRACE_REPORT_ID, cmd] + [0] * (REPORT_LEN - 1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", default="trace.json")
+    parser.add_argument("--seconds", type=float, default=1.0,
+                        help="recording time before the freeze (the rings keep the last part)")
+    parser.add_argument("--personality", choices=DEVICES, default="hori")
+    args = parser.parse_args()
+
+    dev = open_adapter(args.personality)
+    control(dev, TRACE_CMD_RESUME)
+    time.sleep(args.seconds)
+    control(dev, TRACE_CMD_FREEZE)
+    per_core = [read_core(dev, 0), read_core(dev, 1)]
+    control(dev, TRACE_CMD_RESUME)
+
+    with open(args.output, "w") as f:
+        json.dump(to_chrome(per_core), f)
+    print("%s: %d core0 and %d core1 events" % (args.output, len(per_core[0]), len(per_core[1])))
+
+
+if __name__ == "__main__":
+    main()